@@ -4,11 +4,19 @@
 
 #define MAX_DIST    10000
 #define MAX_TIME    3.6e+6
+#define MAX_MEM     2048
+#define CURVE_ORDER 16
+#define CAND_SIZE   10
+#define TOPK_SIZE   0
 #define VERBOSE	    0
 
 #include "utils.h"
 #define REMAIN_TIME(init_time, env) (time_elapsed(init_time) <= env->time_limit)
 
+extern enum { EUC_2D, ATT, CEIL_2D, GEO, EXPLICIT } EDGE_TYPE;
+
+#define PLANAR_METRIC(type) ((type) != GEO && (type) != EXPLICIT)
+
 typedef struct {
     double x;
     double y;
@@ -19,10 +27,26 @@ typedef struct {
     int*   tour;
 } TSPsol;
 
+typedef struct TSPdist TSPdist;
+typedef struct TSPkdtree TSPkdtree;
+typedef struct TSPgraph TSPgraph;
+typedef struct TSPbin TSPbin;
+
 typedef struct{
     unsigned int    nnodes;
     unsigned int    random_seed;
+    int             edge_type;
     point *         points;
+    int*            node_id;
+    double*         xcoord;
+    double*         ycoord;
+    TSPdist*        dist;
+    TSPkdtree*      kdtree;
+    int*            cand;
+    unsigned int    cand_k;
+    unsigned int    topk;
+    TSPgraph*       graph;
+    TSPbin*         bin;
     double          cost;
     int*            solution;
 } TSPinst;
@@ -31,23 +55,35 @@ typedef struct{
     unsigned int    nnodes;
     unsigned int    random_seed;
     char*           file_name;
+    char*           bin_file;
+    char*           tsplib_file;
     char*           method;
+    char*           ls_method;
+    char*           init_method;
 //  char            warm;
     char            perf_v;
     double          time_exec;
     uint64_t        time_limit;
+    double          mem_limit;
+    int             dist_type;
+    int             dist_layout;
+    char            renum;
+    unsigned int    cand_k;
+    unsigned int    topk;
+    unsigned int    graph_q;
+    int             gen_type;
+    int             num_threads;
 //  int             tabu_par;
 //  int             vns_par;
 } TSPenv;
 
-extern double* edge_weights;
-
 //TSPinst functions
 extern TSPinst* instance_new();
 extern TSPinst* instance_new_env(TSPenv*);
 extern void     instance_delete(TSPinst*);
 extern void     instance_set_solution(TSPinst*, const int*, const double);
 extern void     instance_set_best_sol(TSPinst*, const TSPsol);
+extern int      instance_node_id(const TSPinst*, const int);
 
 //TSPenv functions
 extern TSPenv*  environment_new();
@@ -0,0 +1,40 @@
+#ifndef __TSP_BIN_H
+
+#define __TSP_BIN_H
+
+#include "tsp_spatial.h"
+#include <sys/mman.h>
+
+#define TSPB_MAGIC      "TSPBIN\0\0"
+#define TSPB_VERSION    1
+#define TSPB_ALIGN      64
+
+typedef struct {
+    char            magic[8];
+    uint32_t        version;
+    uint32_t        nnodes;
+    int32_t         edge_type;
+    uint32_t        random_seed;
+    int32_t         dist_type;
+    int32_t         dist_layout;
+    uint32_t        cand_k;
+    uint32_t        reserved;
+    uint64_t        x_off;
+    uint64_t        y_off;
+    uint64_t        id_off;
+    uint64_t        dist_off;
+    uint64_t        dist_bytes;
+    uint64_t        cand_off;
+} tspb_header;
+
+struct TSPbin {
+    void*           base;
+    size_t          size;
+};
+
+extern char     tspb_detect(const char*);
+extern void     tspb_load(TSPinst*, const TSPenv*, const char*);
+extern void     tspb_write(const TSPinst*, const char*);
+extern void     tspb_close(TSPinst*);
+
+#endif
@@ -0,0 +1,226 @@
+#ifndef __TSP_DIST_H
+
+#define __TSP_DIST_H
+
+#define EPSILON     1e-7
+
+#include "tsp.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define DIST_X86    1
+#else
+    #define DIST_X86    0
+#endif
+
+#define DIST_ROW(i)         (((size_t)(i) * ((size_t)(i) + 1)) >> 1)
+#define DIST_ROW_BLOCK      64
+#define DIST_TILE_BITS      6
+#define DIST_TILE           (1 << DIST_TILE_BITS)
+
+#define DIST_CACHE_WAYS     4
+#define DIST_CACHE_MIN      (1 << 20)
+#define DIST_SLOT_KEY       ((1ULL << 47) - 1)
+#define DIST_SLOT_VER       (1ULL << 47)
+#define DIST_SLOT_BUSY      (1ULL << 63)
+
+#define COST_EPS(inst)      ((inst)->dist->eps)
+#define DIST_PINNED         -1e8
+
+#define GEO_PI              3.141592
+#define GEO_RADIUS          6378.388
+
+extern enum { Full, Cache, OnTheFly } DIST_MODE;
+extern enum { Double, Float, Int32 } DIST_TYPE;
+extern enum { Rows, Tiled } DIST_LAYOUT;
+
+// distance kernels: full table (layout x type), on-the-fly (metric x type), generic lookup
+#define DIST_KERNELS(X) \
+    X(rows_d)   X(rows_f)   X(rows_i) \
+    X(tiled_d)  X(tiled_f)  X(tiled_i) \
+    X(euc_d)    X(euc_i)    X(ceil_i)   X(att_i) \
+    X(geo_d)    X(geo_i) \
+    X(lookup)
+
+#define DIST_KERNEL_ENUM(name)  Kernel_##name,
+#define DIST_INLINE             static inline __attribute__((always_inline))
+extern enum { DIST_KERNELS(DIST_KERNEL_ENUM) } DIST_KERNEL;
+
+typedef double (*arc_fun)(const TSPdist*, const unsigned int, const unsigned int);
+typedef void (*dist_row_fun)(const double*, const double*, const unsigned int, const double, double*);
+
+typedef struct {
+    uint64_t        tag;
+    double          dist;
+} dist_slot;
+
+struct TSPdist {
+    int             mode;
+    int             type;
+    int             layout;
+    int             metric;
+    int             kernel;
+    double          div;
+    double          eps;
+    size_t          bytes;
+    char            mapped;
+    union {
+        double*     d;
+        float*      f;
+        int32_t*    i;
+        void*       raw;
+    } table;
+    uint32_t*       tile_rank;
+    dist_slot*      cache;
+    uint64_t        cache_sets;
+    const double*   x;
+    const double*   y;
+    const char*     pinned;
+    unsigned int    pinned_n;
+};
+
+typedef struct {
+    TSPdist*            mt_dist;
+    unsigned int        mt_nnodes;
+    dist_row_fun        mt_row_fun;
+    unsigned int        mt_next_row;
+} mt_dist_pars;
+
+extern TSPdist* dist_new(const TSPinst*, const TSPenv*);
+extern TSPdist* dist_explicit_new(const TSPinst*, const TSPenv*);
+extern void     dist_store(TSPdist*, const unsigned int, const unsigned int, const double);
+extern void     dist_pin(TSPdist*, const char*, const unsigned int);
+extern TSPdist* dist_attach(const TSPinst*, const int, const int, void*, const size_t);
+extern void     dist_delete(TSPdist*);
+extern size_t   dist_table_size(const unsigned int);
+extern double   dist_lookup(const TSPdist*, const unsigned int, const unsigned int);
+extern char*    dist_mode_name(const TSPdist*);
+extern int      dist_type_parse(const char*);
+extern int      dist_layout_parse(const char*);
+
+
+/// @brief raw (not rounded) distance between two nodes stored as SoA coordinates
+/// @param div divisor of the squared distance (10 for TSPLIB ATT, 1 otherwise)
+static inline double soa_dist(const double* x, const double* y, const unsigned int i, const unsigned int j, const double div) {
+    double dx = x[j] - x[i];
+    double dy = y[j] - y[i];
+    return sqrt((dx*dx + dy*dy) / div);
+}
+
+
+/// @brief TSPLIB GEO coordinate (DDD.MM degrees.minutes) in radians
+static inline double geo_coord(const double c) {
+    double deg = (int) c;
+    return GEO_PI * (deg + 5.0 * (c - deg) / 3.0) / 180.0;
+}
+
+
+/// @brief raw (not truncated) TSPLIB geographical distance, x = latitude and y = longitude
+static inline double geo_dist(const double* x, const double* y, const unsigned int i, const unsigned int j) {
+    double q1 = cos(geo_coord(y[i]) - geo_coord(y[j]));
+    double q2 = cos(geo_coord(x[i]) - geo_coord(x[j]));
+    double q3 = cos(geo_coord(x[i]) + geo_coord(x[j]));
+    return GEO_RADIUS * acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3));
+}
+
+
+/// @brief TSPLIB integer cost of a raw distance
+/// @param metric edge weight type
+/// @param raw raw distance
+/// @return nint for EUC_2D, pseudo-euclidean rounding for ATT, ceiling for CEIL_2D, truncation + 1 for GEO
+static inline int32_t metric_round(const int metric, const double raw) {
+    switch (metric) {
+        case ATT: {
+            int32_t t = (int32_t) (raw + 0.5);
+            return (t < raw) ? t + 1 : t;
+        }
+        case CEIL_2D:   return (int32_t) ceil(raw);
+        case GEO:       return (int32_t) (raw + 1.0);
+        case EXPLICIT:  return (int32_t) raw;
+        default:        return (int32_t) (raw + 0.5);
+    }
+}
+
+
+/// @brief position of the arc (hi,lo), hi >= lo, inside a Tiled table
+static inline size_t dist_tiled_index(const TSPdist* dist, const unsigned int hi, const unsigned int lo) {
+    const size_t tile = dist->tile_rank[DIST_ROW(hi >> DIST_TILE_BITS) + (lo >> DIST_TILE_BITS)];
+    return (tile << (2 * DIST_TILE_BITS)) + ((size_t)(hi & (DIST_TILE - 1)) << DIST_TILE_BITS) + (lo & (DIST_TILE - 1));
+}
+
+
+/// @brief position of the arc (hi,lo), hi >= lo, inside the full table
+/// @param dist instance of TSPdist (Full mode)
+/// @param hi greater node index
+/// @param lo smaller node index
+/// @return index of the arc (row-major triangle, or DIST_TILE x DIST_TILE tiles in Morton order)
+static inline size_t dist_index(const TSPdist* dist, const unsigned int hi, const unsigned int lo) {
+    return (dist->layout != Tiled) ? DIST_ROW(hi) + lo : dist_tiled_index(dist, hi, lo);
+}
+
+
+/// @brief get distance of the arc i->j (branch-free read when the full table is available)
+/// @param inst instance of TSPinst
+/// @param i node of index i
+/// @param j node of index j
+/// @return distance between i and j (rounded as the storage type requires)
+static inline double get_arc(const TSPinst* inst, const unsigned int i, const unsigned int j) {
+    const TSPdist* dist = inst->dist;
+    if(dist->mode != Full) return dist_lookup(dist, i, j);
+
+    const unsigned int hi = (i > j) ? i : j;
+    const unsigned int lo = (i > j) ? j : i;
+    const size_t q = dist_index(dist, hi, lo);
+    switch (dist->type) {
+        case Int32: return dist->table.i[q];
+        case Float: return dist->table.f[q];
+        default:    return dist->table.d[q];
+    }
+}
+
+
+/// @brief get integer distance of the arc i->j (only meaningful for Int32 storage)
+/// @param inst instance of TSPinst
+/// @param i node of index i
+/// @param j node of index j
+/// @return TSPLIB integer distance between i and j
+static inline int32_t get_iarc(const TSPinst* inst, const unsigned int i, const unsigned int j) {
+    const TSPdist* dist = inst->dist;
+    if(dist->mode != Full) return (int32_t) dist_lookup(dist, i, j);
+
+    const unsigned int hi = (i > j) ? i : j;
+    const unsigned int lo = (i > j) ? j : i;
+    return dist->table.i[dist_index(dist, hi, lo)];
+}
+
+// specialized kernels: every hot loop is instantiated once per kernel (see DIST_KERNELS)
+// and the kernel of an instance is picked once, when its oracle is built
+
+#define DIST_TABLE_KERNEL(name, field, index) \
+    static inline double arc_##name(const TSPdist* dist, const unsigned int i, const unsigned int j) { \
+        const unsigned int hi = (i > j) ? i : j; \
+        const unsigned int lo = (i > j) ? j : i; \
+        return dist->table.field[index]; \
+    }
+
+#define DIST_COORD_KERNEL(name, expr) \
+    static inline double arc_##name(const TSPdist* dist, const unsigned int i, const unsigned int j) { \
+        return expr; \
+    }
+
+DIST_TABLE_KERNEL(rows_d,   d,  DIST_ROW(hi) + lo)
+DIST_TABLE_KERNEL(rows_f,   f,  DIST_ROW(hi) + lo)
+DIST_TABLE_KERNEL(rows_i,   i,  DIST_ROW(hi) + lo)
+DIST_TABLE_KERNEL(tiled_d,  d,  dist_tiled_index(dist, hi, lo))
+DIST_TABLE_KERNEL(tiled_f,  f,  dist_tiled_index(dist, hi, lo))
+DIST_TABLE_KERNEL(tiled_i,  i,  dist_tiled_index(dist, hi, lo))
+
+DIST_COORD_KERNEL(euc_d,    soa_dist(dist->x, dist->y, i, j, 1.0))
+DIST_COORD_KERNEL(euc_i,    metric_round(EUC_2D, soa_dist(dist->x, dist->y, i, j, 1.0)))
+DIST_COORD_KERNEL(ceil_i,   metric_round(CEIL_2D, soa_dist(dist->x, dist->y, i, j, 1.0)))
+DIST_COORD_KERNEL(att_i,    metric_round(ATT, soa_dist(dist->x, dist->y, i, j, 10.0)))
+DIST_COORD_KERNEL(geo_d,    geo_dist(dist->x, dist->y, i, j))
+DIST_COORD_KERNEL(geo_i,    metric_round(GEO, geo_dist(dist->x, dist->y, i, j)))
+DIST_COORD_KERNEL(lookup,   dist_lookup(dist, i, j))
+
+#endif
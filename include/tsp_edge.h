@@ -0,0 +1,38 @@
+#ifndef __TSP_EDGE_H
+
+#define __TSP_EDGE_H
+
+#include "tsp_utils.h"
+
+#define EDGE_RADIX_BITS 8
+#define EDGE_RADIX      (1 << EDGE_RADIX_BITS)
+#define EDGE_BLOCK      65536
+#define EDGE_NODE_BLOCK 1024
+#define EDGE_NONE       UINT64_MAX
+
+typedef struct {
+    uint64_t            key;
+    int                 u, v;
+} edge_item;
+
+typedef struct {
+    const TSPinst*      mt_inst;
+    const int*          mt_cand;
+    unsigned int        mt_k;
+    edge_item*          mt_edges;
+    unsigned int        mt_next_node;
+} mt_collect_pars;
+
+typedef struct {
+    const edge_item*    mt_src;
+    edge_item*          mt_dst;
+    size_t              mt_nedges;
+    unsigned int        mt_shift;
+    size_t*             mt_count;
+    unsigned int        mt_nblocks;
+    unsigned int        mt_next_block;
+} mt_edge_pars;
+
+extern TSPsol   TSPgreedy_edge(const TSPinst*, const TSPenv*, void(const TSPinst*,const TSPenv*,double, int*, double*), char*, double);
+
+#endif
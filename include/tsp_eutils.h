@@ -8,7 +8,7 @@
 
 typedef struct {
     CPXCALLBACKCONTEXTptr  context;
-    unsigned int    nnodes;
+    const TSPinst*  inst;
 } cut_par;
 
 
@@ -17,12 +17,16 @@ extern void             CPLEX_model_new(TSPinst*, CPXENVptr*, CPXLPptr*);
 extern void             CPLEX_model_delete(CPXENVptr*, CPXLPptr*);
 extern void             CPLEX_log(CPXENVptr*, const TSPenv*);
 
-extern void             decompose_solution(const double*, const unsigned int, int*, int*, int*, int*);
-extern void             CPLEX_mip_st(CPXENVptr, CPXLPptr, int*, const unsigned int);
+extern int              CPLEX_ncols(const TSPinst*);
+extern int              CPLEX_xpos(const TSPinst*, const int, const int);
+extern int              CPLEX_xpos_new(CPXENVptr, CPXLPptr, TSPinst*, const int, const int);
+
+extern void             decompose_solution(const double*, const TSPinst*, int*, int*, int*, int*);
+extern void             CPLEX_mip_st(CPXENVptr, CPXLPptr, TSPinst*, const int*);
 //extern void             CPLEX_edit_mip_st(CPXENVptr*, CPXLPptr*, int*, const unsigned int);
 
 //callback
-extern void             add_SEC_mdl(CPXCENVptr, CPXLPptr,const int* , const unsigned int, const unsigned int, int*, int* );
+extern void             add_SEC_mdl(CPXCENVptr, CPXLPptr,const int* , const unsigned int, const TSPinst*, int*, int* );
 extern int              add_SEC_int(CPXCALLBACKCONTEXTptr, TSPinst);
 extern int              add_SEC_flt(CPXCALLBACKCONTEXTptr, TSPinst);
 extern int CPXPUBLIC    mount_CUT(CPXCALLBACKCONTEXTptr, CPXLONG, void*);
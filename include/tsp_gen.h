@@ -0,0 +1,44 @@
+#ifndef __TSP_GEN_H
+
+#define __TSP_GEN_H
+
+#include "tsp.h"
+
+#define GEN_BLOCK           4096
+#define GEN_CLUSTER_SIZE    1000
+#define GEN_TOWN_SHARE      0.3
+#define GEN_ROAD_WIDTH      4.0
+#define GEN_PRECISION       1000.0
+#define GEN_GOLDEN          0x9e3779b97f4a7c15ULL
+
+extern enum { Legacy, Uniform, Clustered, Road } GEN_TYPE;
+
+typedef struct {
+    double              x, y;
+    double              sigma;
+} gen_center;
+
+typedef struct {
+    int                 a, b;
+} gen_road;
+
+typedef struct {
+    int                 type;
+    uint64_t            key;
+    unsigned int        ncenters;
+    gen_center*         centers;
+    unsigned int        nroads;
+    gen_road*           roads;
+} gen_model;
+
+typedef struct {
+    const gen_model*    mt_model;
+    point*              mt_points;
+    unsigned int        mt_nnodes;
+    unsigned int        mt_next_node;
+} mt_gen_pars;
+
+extern void     gen_points(point*, const unsigned int, const unsigned int, const int);
+extern int      gen_type_parse(const char*);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef __TSP_KARP_H
+
+#define __TSP_KARP_H
+
+#include "tsp_lk.h"
+
+#define KARP_CELL       1000
+#define KARP_MIN_CELL   8
+#define KARP_VARIANTS   4
+
+typedef struct {
+    double              key;
+    int                 node;
+} karp_item;
+
+typedef struct {
+    unsigned int        ncells;
+    int*                cell;
+    unsigned int*       solved;
+} karp_partition;
+
+typedef struct {
+    const TSPinst*      mt_inst;
+    const TSPenv*       mt_env;
+    double              mt_init_time;
+    const int*          mt_tour;
+    const int*          mt_pos;
+    const int*          mt_cell_start;
+    const int*          mt_cell_nodes;
+    const int*          mt_cell;
+    const int*          mt_local;
+    const int*          mt_run;
+    unsigned int        mt_nruns;
+    int*                mt_adj;
+    int*                mt_mate;
+    double*             mt_gain;
+    char*               mt_todo;
+    unsigned int        mt_ncells;
+    unsigned int        mt_next_cell;
+} mt_karp_pars;
+
+extern void     TSPkarp(const TSPinst*, const TSPenv*, double, int*, double*);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef __TSP_LK_H
+
+#define __TSP_LK_H
+
+#include "tsp_utils.h"
+
+#define LK_MAX_DEPTH    50
+#define LK_BREADTH_0    5
+#define LK_BREADTH_1    3
+#define LK_BREADTH      {LK_BREADTH_0, LK_BREADTH_1}
+#define LK_MAX_BREADTH  LK_BREADTH_0
+
+_Static_assert(LK_MAX_BREADTH >= LK_BREADTH_0 && LK_MAX_BREADTH >= LK_BREADTH_1, "LK_MAX_BREADTH below an entry of LK_BREADTH");
+
+typedef struct {
+    int                 t2, t3, t4;
+} lk_step;
+
+typedef struct {
+    int                 t3, t4;
+    double              g2;
+} lk_choice;
+
+typedef struct {
+    const TSPinst*      inst;
+    TSPtour*            tour;
+    int                 t1, t2;
+    unsigned int        depth;
+    lk_step             step[LK_MAX_DEPTH];
+} lk_state;
+
+extern void     TSPlk(const TSPinst*, const TSPenv*, double, int*, double*);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef __TSP_PARSER_H
+
+#define __TSP_PARSER_H
+
+#include "tsp_dist.h"
+#include <sys/mman.h>
+
+#define SCAN_DIGITS     19
+#define SCAN_EXACT_POW  22
+#define SCAN_TOKEN      64
+
+extern enum { FullMatrix, UpperRow, LowerRow, UpperDiagRow, LowerDiagRow } WEIGHT_FORMAT;
+
+typedef struct {
+    const char*     cur;
+    const char*     end;
+} tsp_scanner;
+
+extern void     tsplib_read(TSPinst*, const TSPenv*, const char*);
+extern void     tsplib_write(const TSPinst*, const char*);
+
+#endif
@@ -5,21 +5,50 @@
 #define MAX_DIST    10000
 #define MAX_TIME    3.6e+6
 
-#include "tsp_utils.h"
+#define GREEDY_GAP          0.05
+#define GREEDY_BUILD_SHARE  0.5
+
+#include "tsp_karp.h"
+#include "tsp_edge.h"
+
+typedef void (*opt_fun)(const TSPinst*, const TSPenv*, double, int*, double*);
+
+extern enum { Built, Taken, Improved } SLOT_STATE;
+
+typedef struct{
+    TSPsol              sol;
+    double              key;
+    unsigned int        start;
+    unsigned int        gen;
+    char                state;
+} greedy_slot;
 
 typedef struct{
     const TSPinst*      mt_inst;
     void*               mt_opt_fun;
     double              mt_init_time;
+    double              mt_build_time;
     TSPenv*             mt_env;
-    TSPsol*             mt_greedy_sol; 
+    greedy_slot*        mt_slots;
+    unsigned int        mt_nslots;
+    unsigned int        mt_cap;
+    char                mt_filter;
+    double              mt_best_greedy;
+    unsigned int        mt_building;
+    pthread_cond_t      mt_ready;
+    unsigned int        mt_next_start;
 } mt_greedy_pars;
 
 extern void     TSPsolve(TSPinst*, TSPenv*);
 
 extern TSPsol   TSPgreedy(const TSPinst*, const TSPenv*, const unsigned int, void(const TSPinst*,const TSPenv*,double, int*, double*), char*, double);
+extern TSPsol   TSPstart(const TSPinst*, const TSPenv*, const unsigned int, void(const TSPinst*,const TSPenv*,double, int*, double*), char*, double);
 extern void     TSPg2opt(const TSPinst*,const TSPenv*,double, int*, double*);
 extern void     TSPg2optb(const TSPinst*, const TSPenv*,double, int*, double*);
+extern void     TSPg2optnl(const TSPinst*, const TSPenv*,double, int*, double*);
+extern void     TSPoropt(const TSPinst*, const TSPenv*,double, int*, double*);
+extern void     TSPoroptb(const TSPinst*, const TSPenv*,double, int*, double*);
+extern opt_fun  local_search_func(const TSPenv*);
 extern TSPsol   TSPtabu(TSPinst*, const TSPenv*, const double);
 extern TSPsol   TSPvns(TSPinst*, const TSPenv*, const double);
 
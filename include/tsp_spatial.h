@@ -0,0 +1,80 @@
+#ifndef __TSP_SPATIAL_H
+
+#define __TSP_SPATIAL_H
+
+#include "tsp_dist.h"
+
+#define KD_BUCKET   8
+#define CAND_ALIGN  64
+
+typedef struct {
+    int             lo, hi;
+    int             left, right;
+    int             parent;
+    double          xmin, xmax, ymin, ymax;
+} kd_node;
+
+struct TSPkdtree {
+    unsigned int    nnodes;
+    int             size;
+    int*            perm;
+    int*            leaf;
+    kd_node*        nodes;
+    const double*   x;
+    const double*   y;
+};
+
+struct TSPgraph {
+    unsigned int    nnodes;
+    size_t          nedges;
+    size_t*         start;
+    int*            adj;
+    int*            edge_u;
+    int*            edge_v;
+    size_t          nextra;
+    size_t          extra_cap;
+    uint64_t*       extra;
+};
+
+typedef struct {
+    double          dist;
+    int             index;
+} kd_neighbor;
+
+typedef struct {
+    const TSPinst*      mt_inst;
+    int*                mt_cand;
+    unsigned int        mt_k;
+    unsigned int        mt_next_node;
+} mt_cand_pars;
+
+typedef struct {
+    const TSPinst*      mt_inst;
+    uint64_t*           mt_arcs;
+    unsigned int        mt_quad;
+    unsigned int        mt_next_node;
+} mt_graph_pars;
+
+typedef struct {
+    const TSPkdtree*    tree;
+    int*                alive;
+    char*               removed;
+} kd_query;
+
+extern TSPkdtree*   kdtree_new(const TSPinst*);
+extern void         kdtree_delete(TSPkdtree*);
+
+extern kd_query*    kdquery_new(const TSPkdtree*);
+extern void         kdquery_delete(kd_query*);
+extern void         kdquery_remove(kd_query*, const int);
+extern int          kdquery_nearest(const kd_query*, const int, double*);
+
+extern int          kdtree_knn(const TSPkdtree*, const int, const unsigned int, kd_neighbor*);
+extern int*         cand_new(const TSPinst*, const unsigned int);
+
+extern TSPgraph*    graph_new(const TSPinst*, const unsigned int);
+extern void         graph_delete(TSPgraph*);
+extern char         graph_has_edge(const TSPgraph*, const int, const int);
+extern size_t       graph_edge_index(const TSPgraph*, const int, const int);
+
+#endif
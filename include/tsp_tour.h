@@ -0,0 +1,67 @@
+#ifndef __TSP_TOUR_H
+
+#define __TSP_TOUR_H
+
+#include "tsp.h"
+
+#define TOUR_LIST_MIN   8192
+#define TOUR_SEG_SLACK  4
+#define TOUR_AUTO(n)    (((n) < TOUR_LIST_MIN) ? Array : TwoLevel)
+
+extern enum { Array, TwoLevel } TOUR_TYPE;
+
+typedef struct {
+    int             lo, hi;
+    int             rank;
+    char            reversed;
+} tour_seg;
+
+typedef struct {
+    int             type;
+    unsigned int    nnodes;
+    int*            order;
+    int*            pos;
+    unsigned int    nseg;
+    unsigned int    maxseg;
+    tour_seg*       seg;
+    int*            seg_order;
+    int*            node_seg;
+    int*            buffer;
+} TSPtour;
+
+extern TSPtour* tour_new(int*, const unsigned int, const int);
+extern void     tour_delete(TSPtour*);
+extern void     tour_get(const TSPtour*, int*);
+extern char     tour_between(const TSPtour*, const int, const int, const int);
+extern void     tour_flip(TSPtour*, const int, const int);
+extern void     tour_flip_path(TSPtour*, const int, const int, const int);
+
+
+/// @brief node after a in the current direction of the tour
+static inline int tour_next(const TSPtour* t, const int a) {
+    const int k = t->pos[a];
+    if(t->type == Array) return t->order[(k+1 == (int) t->nnodes) ? 0 : k+1];
+
+    const tour_seg* s = &t->seg[t->node_seg[a]];
+    if(!s->reversed) { if(k+1 < s->hi) return t->order[k+1]; }
+    else if(k > s->lo) return t->order[k-1];
+
+    const tour_seg* ns = &t->seg[t->seg_order[(s->rank+1 == (int) t->nseg) ? 0 : s->rank+1]];
+    return ns->reversed ? t->order[ns->hi-1] : t->order[ns->lo];
+}
+
+
+/// @brief node before a in the current direction of the tour
+static inline int tour_prev(const TSPtour* t, const int a) {
+    const int k = t->pos[a];
+    if(t->type == Array) return t->order[(k == 0) ? (int) t->nnodes-1 : k-1];
+
+    const tour_seg* s = &t->seg[t->node_seg[a]];
+    if(!s->reversed) { if(k > s->lo) return t->order[k-1]; }
+    else if(k+1 < s->hi) return t->order[k+1];
+
+    const tour_seg* ps = &t->seg[t->seg_order[(s->rank == 0) ? (int) t->nseg-1 : s->rank-1]];
+    return ps->reversed ? t->order[ps->lo] : t->order[ps->hi-1];
+}
+
+#endif
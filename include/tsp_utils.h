@@ -2,9 +2,8 @@
 
 #define __TSP_UTILS_H
 
-#define EPSILON     1e-7
-
-#include "tsp.h"
+#include "tsp_spatial.h"
+#include "tsp_tour.h"
 
 typedef struct{
     unsigned int    i,j;
@@ -16,20 +15,86 @@ typedef struct {
     unsigned int    index;
 } near_neighbor;
 
+#define G2OPT_AREA      (1 << 14)
+#define CACHE_LINE      64
+
+typedef struct {
+    cross           move;
+} __attribute__((aligned(CACHE_LINE))) cross_slot;
+
+typedef struct {
+    unsigned int        i, j;
+    int                 count;
+} tabu_bucket;
+
+typedef struct {
+    tabu_bucket*        bucket;
+    unsigned int*       slot;
+    unsigned int        mask;
+    int                 size;
+} tabu_filter;
+
+typedef struct {
+    const TSPinst*      inst;
+    const TSPtour*      tour;
+    unsigned int        leaves;
+    cross*              move;
+    int*                tree;
+    tabu_filter         filter;
+    int*                rcand_start;
+    int*                rcand;
+    char                dirty;
+} cross_cache;
+
+#define OROPT_MAX_LEN   3
+#define OROPT_BLOCK     1024
+
+typedef struct {
+    int             s, len;
+    int             u;
+    char            reversed;
+    double          delta_cost;
+} oropt_move;
+
+typedef struct {
+    oropt_move      move;
+} __attribute__((aligned(CACHE_LINE))) oropt_slot;
+
+#define SIMD_PREFETCH   64
+
+typedef struct {
+    double*         x;
+    double*         y;
+    double*         edge;
+    double          div;
+    int             metric;
+    char            rounded;
+} tour_buffer;
+
 typedef struct {
-    mt_context*         mt_ctx;
     const TSPinst*      mt_inst;
     const int*          mt_tour;
-    cross*              mt_cross;
+    const tour_buffer*  mt_buf;
+    const int*          mt_block_start;
+    cross_slot*         mt_block_cross;
+    unsigned int        mt_nblocks;
+    unsigned int        mt_next_block;
     const cross*        mt_tabu; 
     const int           mt_tabu_size; 
 } mt_g2o_pars;
 
+typedef struct {
+    const TSPinst*      mt_inst;
+    const TSPtour*      mt_tour;
+    oropt_slot*         mt_block_move;
+    unsigned int        mt_nblocks;
+    unsigned int        mt_next_block;
+} mt_oro_pars;
+
 
 //generic functions
 extern double   euc_2d(const point, const point);
 extern double   delta_cost(const TSPinst*, const unsigned int, const unsigned int, const unsigned int, const unsigned int);
-extern double   get_arc(const TSPinst*, const unsigned int, const unsigned int);
 extern void     check_tour_cost(const TSPinst*, const int*, const double);
 extern double   compute_cost(TSPinst*,const int*);
 
@@ -38,13 +103,28 @@ extern near_neighbor get_nearest_neighbor(const TSPinst*, const unsigned int, co
 
 //G2opt functions
 extern double   check_cross(const TSPinst*,const int*, const unsigned int, const unsigned int);
-extern cross    find_first_cross(const TSPinst*, const int*);
+extern int      find_first_crosses(const TSPinst*, const int*, cross*);
 extern cross    find_best_cross(const TSPinst*, const int*);
 
 //TABU functions
 extern char     is_in_tabu(int, int, const cross*, const int);
+extern void     tabu_mirror(cross*, const int, const int, const int);
 extern cross    find_best_t_cross(const TSPinst*, const int*, const cross*, const int);
 
+//G2opt neighbor list functions
+extern cross    find_nl_cross(const TSPinst*, const TSPtour*, const unsigned int);
+
+//2opt best-move cache functions
+extern cross_cache* cross_cache_new(const TSPinst*, const TSPtour*, const cross*, const int);
+extern void         cross_cache_delete(cross_cache*);
+extern void         cross_cache_touch(cross_cache*, const int*, const int, const cross*, const int);
+extern cross        cross_cache_best(cross_cache*, const cross*, const int);
+
+//Or-opt functions
+extern oropt_move   find_first_oropt(const TSPinst*, const TSPtour*, const unsigned int);
+extern oropt_move   find_best_oropt(const TSPinst*, const TSPtour*);
+extern void         apply_oropt(TSPtour*, const oropt_move);
+
 //VNS functions
 extern double     kick(TSPinst*, int*, const unsigned int);
 
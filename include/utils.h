@@ -9,6 +9,7 @@
 #include <float.h> 
 #include <sys/time.h>
 #include <stdint.h>
+#include <limits.h>
 #include <sys/stat.h>
 #include <stdarg.h>
 #include <pthread.h> 
@@ -27,14 +28,41 @@ extern enum { Error, Warn, Info } TYPE_MESSAGE;
 #define ANSI_COLOR_CYAN    "\x1b[36m"
 #define ANSI_COLOR_RESET   "\x1b[0m"
 
+#define EDGE_COUNT(n)   ((size_t) (n) * ((n) - 1) / 2)
+
+#define MT_QUEUE_SIZE      64
+
 typedef struct{
     int num_threads;
     pthread_mutex_t mutex;
-    pthread_t* threads;
+    int pending;
 } mt_context;
 
+typedef struct{
+    void* (*funct)(void*);
+    void* args;
+    int* pending;
+} mt_task;
+
+typedef struct{
+    pthread_mutex_t lock;
+    mt_task* tasks;
+    int head, tail, cap;
+} mt_queue;
+
+typedef struct{
+    int num_workers;
+    pthread_t* workers;
+    mt_queue* queues;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    int queued;
+    char stop;
+} mt_pool;
+
 extern void     print_state(int, const char*, ...);
-extern int      coords_to_index(const unsigned int, const int, const int);
+extern size_t   coords_to_index(const unsigned int, const int, const int);
 extern double   get_time();
 extern double   time_elapsed(const double);
 extern void     reverse(int*,unsigned int,unsigned int);
@@ -52,4 +80,11 @@ extern mt_context*      new_mt_context(int,char);
 extern void             run_job(mt_context*,void* (*funct)(void*) ,void* );
 extern void             delete_mt_context(mt_context*,char);
 extern void             run_mt_context(mt_context* ,int ,void* (*funct)(void*) ,void* );
+
+//thread pool
+extern void             mt_pool_init(int);
+extern int              mt_pool_size();
+extern void             mt_pool_submit(int*, void* (*funct)(void*), void*);
+extern void             mt_pool_wait(int*);
+extern void             mt_pool_close();
 #endif
\ No newline at end of file
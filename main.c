@@ -1,12 +1,22 @@
 #include "include/tsp_solver.h"
 #include "include/tsp_exact.h"
 #include "include/matheuristic.h"
+#include "include/tsp_bin.h"
+#include "include/tsp_parser.h"
 
 
 int main(int argc, char **argv) {
     TSPenv* env = environment_new_cli(argv, argc);
     TSPinst* inst = instance_new_env(env);
 
+    if(env->bin_file[0] || env->tsplib_file[0]) {
+        if(env->bin_file[0]) tspb_write(inst, env->bin_file);
+        if(env->tsplib_file[0]) tsplib_write(inst, env->tsplib_file);
+        instance_delete(inst);
+        environment_delete(env);
+        return 0;
+    }
+
     char* cplex_func[] = { "BENDERS", "BRANCH_CUT" };
     char* mathe_func[] = { "DIVING_R", /*"DIVING_P",*/ "DIVING_W", "LOCAL_BRANCH" };
 
@@ -22,10 +22,10 @@ void MATsolve(TSPinst* inst, TSPenv* env) {
 
 void diving(int strategy, CPXENVptr CPLEX_env, CPXLPptr CPLEX_lp, TSPinst* inst, TSPenv* env, const double start_time) { 
 
-    TSPsol sol = TSPgreedy(inst, env, rand()%inst->nnodes, NULL, "", start_time);   
+    TSPsol sol = TSPstart(inst, env, rand()%inst->nnodes, NULL, "", start_time);   
     TSPsol oldsol = sol;
     instance_set_solution(inst, sol.tour, sol.cost);
-    CPLEX_mip_st(CPLEX_env, CPLEX_lp, inst->solution, inst->nnodes);
+    CPLEX_mip_st(CPLEX_env, CPLEX_lp, inst, inst->solution);
 
     int* x = calloc(inst->nnodes, sizeof(int));
     int x_size = 0;
@@ -52,7 +52,7 @@ void diving(int strategy, CPXENVptr CPLEX_env, CPXLPptr CPLEX_lp, TSPinst* inst,
         }
         oldsol = sol;
 
-        CPLEX_mip_st(CPLEX_env, CPLEX_lp, inst->solution, inst->nnodes);
+        CPLEX_mip_st(CPLEX_env, CPLEX_lp, inst, inst->solution);
         unfix_to_model(CPLEX_env, CPLEX_lp, x, x_size);
     }
 }
@@ -60,10 +60,10 @@ void diving(int strategy, CPXENVptr CPLEX_env, CPXLPptr CPLEX_lp, TSPinst* inst,
 
 void local_branching(CPXENVptr CPLEX_env, CPXLPptr CPLEX_lp, TSPinst* inst, TSPenv* env, const double start_time) {
 
-    TSPsol sol = TSPgreedy(inst, env, rand()%inst->nnodes, TSPg2optb, "G2OPT_B", start_time);  
+    TSPsol sol = TSPstart(inst, env, rand()%inst->nnodes, TSPg2optb, "G2OPT_B", start_time);  
     TSPsol oldsol = sol; 
     instance_set_solution(inst, sol.tour, sol.cost);
-    CPLEX_mip_st(CPLEX_env, CPLEX_lp, inst->solution, inst->nnodes);
+    CPLEX_mip_st(CPLEX_env, CPLEX_lp, inst, inst->solution);
     int k = 150;
     int deltak = 10;
 
@@ -89,7 +89,7 @@ void local_branching(CPXENVptr CPLEX_env, CPXLPptr CPLEX_lp, TSPinst* inst, TSPe
 
         int nrows = CPXgetnumrows(CPLEX_env, CPLEX_lp);
         CPXdelrows(CPLEX_env, CPLEX_lp, nrows-1, nrows-1);
-        CPLEX_mip_st(CPLEX_env, CPLEX_lp, inst->solution, inst->nnodes);
+        CPLEX_mip_st(CPLEX_env, CPLEX_lp, inst, inst->solution);
     }
     
 
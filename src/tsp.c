@@ -1,24 +1,43 @@
-#include "../include/tsp.h"
-
-double* edge_weights;
+#include "../include/tsp_bin.h"
+#include "../include/tsp_parser.h"
+#include "../include/tsp_gen.h"
 
 #pragma region static_functions
 
 /// @brief print output for help function
 static void help_info(){
     printf("\e[1mTo set the parameters properly you have to execute tsp and add:\e[m");
-    printf("\n '-in / -f / -file <filename.tsp>' to specity the input file; ");
+    printf("\n '-in / -f / -file <filename.tsp>' to specity the input file (TSPLIB EUC_2D, CEIL_2D, ATT, GEO or EXPLICIT, optionally gzipped, or .tspb); ");
+    printf("\n '-convert / -tspb <filename.tspb>' to write the instance (with distances and candidate lists) as a binary file and exit;");
+    printf("\n '-export / -tsplib <filename.tsp>' to write the instance as a TSPLIB file and exit;");
     printf("\n '-tl / -max_time <time_dbl>' to specity the max execution time (int value);");
     printf("\n '-n / -n_nodes <num_nodes_int>' to specify the number of nodes in the TSP instance (int value);");
     printf("\n '-seed / -rnd_seed <seed>' to specity the random seed (int value);");
+    printf("\n '-gen / -generator <UNIFORM|CLUSTER|ROAD>' to generate the random instance in parallel (uniform, gaussian blobs or road network);");
+    printf("\n '-mem / -mem_limit <MB>' to specify the memory budget for distances (full table, cache or on-the-fly);");
+    printf("\n '-dist / -dist_type <DOUBLE|FLOAT|INT>' to store distances as double, float or TSPLIB rounded int;");
+    printf("\n '-layout / -dist_layout <ROWS|TILED>' to store the distance table by rows or in 64x64 tiles (Morton order);");
+    printf("\n '-k / -cand <k>' to specify the size of the candidate neighbor lists (0 to disable);");
+    printf("\n '-graph / -quadrant <q>' to build a sparse candidate graph with the q nearest nodes per quadrant (restricts the CPLEX model and patching);");
+    printf("\n '-threads / -j <num_threads>' to specify the size of the thread pool (default: every online core);");
+    printf("\n '-renum / -hilbert' to renumber nodes along a Hilbert curve (better cache locality);");
+    printf("\n '-ls / -local_search <G2OPT_B|G2OPT_NL|LK>' to specify the local search used by VNS and by the CPLEX warm start;");
+    printf("\n '-init / -construct <GREEDY|GREEDY_EDGE>' to specify the starting tour of the local searches, TABU, VNS, diving and the CPLEX warm start;");
+    printf("\n '-topk / -starts <k>' to improve only the k best greedy starts (default 0: every start);");
     printf("\n '-algo / -method / -alg <method>' to specify the method to solve the TSP instance;");
     printf("\n Implemented method:\
     \n\t- GREEDY = greedy search\
+    \n\t- GREEDY_EDGE = greedy edge over the candidate lists\
     \n\t- G2OPT_F = greedy + 2opt w. first swaps\
     \n\t- G2OPT_B = greedy + 2opt w. best swaps\
+    \n\t- G2OPT_NL = greedy + 2opt on the candidate lists w. don't-look bits\
+    \n\t- OROPT_F = greedy + Or-opt w. first moves (don't-look bits)\
+    \n\t- OROPT_B = greedy + Or-opt w. best moves\
+    \n\t- LK = greedy + Lin-Kernighan style variable-depth search\
+    \n\t- KARP = greedy + 2opt (set by -ls) and Or-opt on k-d cells optimized in parallel\
     \n\t- TABU_R = tabu search w. greedy as starting solution\
     \n\t- TABU_B = tabu search w. greedy + 2opt as starting solution\
-    \n\t- VNS = vns search w. 2opt best swaps\
+    \n\t- VNS = vns search w. 2opt (best swaps, or the one set by -ls) + Or-opt\
     \n\t- BENDERS = benders' loop\
     \n\t- BRANCH_CUT = branch-and-cut\
     \n\t- DIVING_R = diving w. random fixed edges\
@@ -34,11 +53,11 @@ static void help_info(){
 /// @param inst instance of TSPinst
 /// @param nnodes number of nodes inside TSP inst
 /// @param seed seed to set random instance.
-static void tsp_rnd_inst(TSPinst* inst, unsigned int nnodes, const unsigned int seed) {
+/// @param gen generator: Legacy (serial rand() on the integer grid) or a parallel one of tsp_gen
+static void tsp_rnd_inst(TSPinst* inst, unsigned int nnodes, const unsigned int seed, const int gen) {
     inst->nnodes = nnodes;
     inst->random_seed = seed;
     inst->points = (point *) calloc(inst->nnodes, sizeof(point));
-    edge_weights = (double *) calloc(((inst->nnodes*(inst->nnodes-1)/2)), sizeof(double));
     inst->solution = malloc(nnodes * sizeof(int));
 
     srand(seed);
@@ -49,6 +68,8 @@ static void tsp_rnd_inst(TSPinst* inst, unsigned int nnodes, const unsigned int
         printf("\e[1mGENERATE RANDOM POINT...\e[m\n");
     #endif
 
+    if(gen != Legacy) { gen_points(inst->points, nnodes, seed, gen); return; }
+
     for(int i = 0; i < nnodes; i++) {
         point p = {.x = rand() % MAX_DIST, .y = rand() % MAX_DIST};
         inst->points[i] = p;
@@ -63,70 +84,81 @@ static void tsp_rnd_inst(TSPinst* inst, unsigned int nnodes, const unsigned int
 }
 
 
-/// @brief parser of .tsp file
-/// @param inst instance of TSPinst
-/// @param file name of .tsp file
-static void tsp_read_file(TSPinst* inst, const char* file) {
-    FILE *f = fopen(file, "r");
-
-    if ( f == NULL ){
-        instance_delete(inst);
-        print_state(Error, "input file not found!");
+/// @brief position of a cell along the Hilbert curve of a 2^order x 2^order grid
+/// @param x cell column
+/// @param y cell row
+/// @param order curve order
+/// @return index of the cell along the curve
+static uint64_t hilbert_index(uint32_t x, uint32_t y, const int order) {
+    uint64_t d = 0;
+    for(uint32_t s = 1u << (order - 1); s > 0; s >>= 1) {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        d += (uint64_t) s * s * ((3 * rx) ^ ry);
+
+        if(ry == 0) {
+            if(rx == 1) { x = s - 1 - x; y = s - 1 - y; }
+            uint32_t t = x; x = y; y = t;
+        }
     }
+    return d;
+}
 
-    char line[201];
-    char node_section = 0;
-    char *par_name;   
-
-    while(fgets(line, sizeof(line), f) != NULL){
-    
-        if (strlen(line) <= 1) continue; 
 
-        if(!node_section) par_name = strtok(line, " :");
-        else par_name=strtok(line, " ");
+typedef struct {
+    uint64_t    key;
+    int         id;
+} curve_node;
 
-        if (!strncmp(par_name, "TYPE", 4)) {
-            if (strncmp(strtok(NULL, " :"), "TSP",3)){
-                instance_delete(inst);
-                print_state(Error, " format error: only TYPE: TSP implemented!"); 
-            }
-        }
-        
-        if (!strncmp(par_name, "DIMENSION", 9)){
-            if (inst->nnodes > 0){
-                instance_delete(inst);
-                print_state(Error, " repeated DIMENSION section in input file!");
-            }
-            
-            inst->nnodes = atoi(strtok(NULL, " :"));
-            inst->points = (point *) calloc(inst->nnodes, sizeof(point));
-            edge_weights = (double *) calloc(((inst->nnodes*(inst->nnodes-1)/2)), sizeof(double));
-            inst->solution = malloc(inst->nnodes * sizeof(int));
-
-            if (inst->points == NULL) print_state(Error, " failed to allocate memory for points vector!");
-            if (edge_weights == NULL) print_state(Error, " failed to allocate memory for edge_weights vector!");
+static int curve_ascending(const void* elem1, const void* elem2) {
+    uint64_t f = ((curve_node*) elem1)->key;
+    uint64_t s = ((curve_node*) elem2)->key;
+    return (f > s) - (f < s);
+}
 
-        }
 
-        if (!strncmp(par_name, "EDGE_WEIGHT_TYPE", 16)){
-            if (strncmp(strtok(NULL, " :"), "ATT",3)){
-                instance_delete(inst);
-                print_state(Error, " format error: only EDGE_WEIGHT_TYPE: ATT implemented!"); 
-            }
-        }
+/// @brief renumber nodes along a Hilbert curve so that close nodes get close indices
+/// @param inst instance of TSPinst (points loaded, no distance built yet)
+static void tsp_renumber(TSPinst* inst) {
+    double xmin = INFINITY, xmax = -INFINITY, ymin = INFINITY, ymax = -INFINITY;
+    for(int i = 0; i < inst->nnodes; i++) {
+        xmin = fmin(xmin, inst->points[i].x); xmax = fmax(xmax, inst->points[i].x);
+        ymin = fmin(ymin, inst->points[i].y); ymax = fmax(ymax, inst->points[i].y);
+    }
+    double side = fmax(xmax - xmin, ymax - ymin);
+    double scale = (side > 0) ? ((1u << CURVE_ORDER) - 1) / side : 0;
+
+    curve_node* order = (curve_node*) malloc(inst->nnodes * sizeof(curve_node));
+    for(int i = 0; i < inst->nnodes; i++) {
+        uint32_t cx = (uint32_t) ((inst->points[i].x - xmin) * scale);
+        uint32_t cy = (uint32_t) ((inst->points[i].y - ymin) * scale);
+        order[i] = (curve_node) { .key = hilbert_index(cx, cy, CURVE_ORDER), .id = i };
+    }
+    qsort(order, inst->nnodes, sizeof(curve_node), curve_ascending);
 
-        if (!strncmp(par_name, "NODE_COORD_SECTION", 18)) node_section=1;
+    point* sorted = (point*) malloc(inst->nnodes * sizeof(point));
+    inst->node_id = (int*) malloc(inst->nnodes * sizeof(int));
+    for(int i = 0; i < inst->nnodes; i++) {
+        sorted[i] = inst->points[order[i].id];
+        inst->node_id[i] = order[i].id;
+    }
 
-        if (!strncmp(par_name, "EOF", 3)) node_section=0;
+    free(inst->points);
+    inst->points = sorted;
+    free(order);
+}
 
-        if(node_section){
-            int i = atoi(par_name)-1;
-            if ( i >= 0 && i < inst->nnodes ){
-                inst->points[i].x = atof(strtok(NULL, " "));
-                inst->points[i].y = atof(strtok(NULL, " "));
-            }
-        }
 
+/// @brief copy points into SoA coordinates (used by every distance kernel)
+/// @param inst instance of TSPinst
+static void tsp_soa_coords(TSPinst* inst) {
+    inst->xcoord = (double*) malloc(inst->nnodes * sizeof(double));
+    inst->ycoord = (double*) malloc(inst->nnodes * sizeof(double));
+    if (inst->xcoord == NULL || inst->ycoord == NULL) print_state(Error, " failed to allocate memory for coordinates!");
+
+    for(int i = 0; i < inst->nnodes; i++) {
+        inst->xcoord[i] = inst->points[i].x;
+        inst->ycoord[i] = inst->points[i].y;
     }
 }
 
@@ -156,11 +188,25 @@ TSPinst* instance_new_env(TSPenv* env) {
     init_random();
 
     if(!strncmp(env->file_name,"RND",3) || fopen(env->file_name, "r") == NULL ){
-        tsp_rnd_inst(inst, env->nnodes,env->random_seed);
+        tsp_rnd_inst(inst, env->nnodes,env->random_seed, env->gen_type);
+    }else if(tspb_detect(env->file_name)){
+        tspb_load(inst, env, env->file_name);
     }else{
-        tsp_read_file(inst,env->file_name);
+        tsplib_read(inst, env, env->file_name);
     }
 
+    // a binary instance is already numbered and stored in SoA form, explicit weights fix the numbering
+    if(inst->bin == NULL) {
+        if(env->renum && inst->dist == NULL) tsp_renumber(inst);
+        tsp_soa_coords(inst);
+    }
+    if(inst->dist == NULL) inst->dist = dist_new(inst, env);
+    if(PLANAR_METRIC(inst->edge_type)) inst->kdtree = kdtree_new(inst);
+
+    inst->cand_k = (env->cand_k < inst->nnodes) ? env->cand_k : inst->nnodes - 1;
+    if(inst->cand_k && inst->cand == NULL) inst->cand = cand_new(inst, inst->cand_k);
+    if(env->graph_q) inst->graph = graph_new(inst, env->graph_q);
+
     #if VERBOSE > 0
         printf("------\e[1mInstance data\e[m------");
         printf("\n - nodes : %i",inst->nnodes);
@@ -175,8 +221,15 @@ TSPinst* instance_new_env(TSPenv* env) {
 /// @brief free memory of an instance of TSPinst
 /// @param inst instance of TSPinst
 void instance_delete(TSPinst* inst) {
+    tspb_close(inst);
     free(inst->points);
-    free(edge_weights);
+    free(inst->node_id);
+    free(inst->xcoord);
+    free(inst->ycoord);
+    dist_delete(inst->dist);
+    kdtree_delete(inst->kdtree);
+    free(inst->cand);
+    graph_delete(inst->graph);
     free(inst->solution);
     free(inst);
 
@@ -202,6 +255,15 @@ void instance_set_best_sol(TSPinst* inst, const TSPsol sol) {
 }
 
 
+/// @brief original (file / generator) id of a node
+/// @param inst instance of TSPinst
+/// @param i internal index of the node
+/// @return id of the node before renumbering
+int instance_node_id(const TSPinst* inst, const int i) {
+    return (inst->node_id == NULL) ? i : inst->node_id[i];
+}
+
+
 /*===============================================================================*/
 
 
@@ -210,8 +272,17 @@ void instance_set_best_sol(TSPinst* inst, const TSPsol sol) {
 TSPenv* environment_new() {
     TSPenv *environment = (TSPenv*) calloc(1,sizeof(TSPenv));
     environment->file_name = calloc(64, sizeof(char));
+    environment->bin_file = calloc(64, sizeof(char));
+    environment->tsplib_file = calloc(64, sizeof(char));
     environment->method = calloc(23, sizeof(char));
+    environment->ls_method = calloc(23, sizeof(char));
+    strcpy(environment->ls_method, "G2OPT_B");
+    environment->init_method = calloc(23, sizeof(char));
+    strcpy(environment->init_method, "GREEDY");
     environment->time_limit = MAX_TIME;
+    environment->mem_limit = MAX_MEM;
+    environment->cand_k = CAND_SIZE;
+    environment->topk = TOPK_SIZE;
     environment->time_exec = 0;
     environment->perf_v = 0;
 
@@ -236,6 +307,19 @@ TSPenv* environment_new_cli(char** argv, const int argc) {
     char* algo_comm[] = {"-algo", "-method", "-alg"};
     char* seed_comm[] = {"-seed", "-rnd_seed", "-s"};
     char* help_comm[] = {"-help", "-h", "--help"};
+    char* mem_comm[]  = {"-mem", "-mem_limit"};
+    char* dist_comm[] = {"-dist", "-dist_type"};
+    char* renum_comm[] = {"-renum", "-hilbert"};
+    char* layout_comm[] = {"-layout", "-dist_layout"};
+    char* cand_comm[] = {"-k", "-cand"};
+    char* graph_comm[] = {"-graph", "-quadrant"};
+    char* bin_comm[] = {"-convert", "-tspb"};
+    char* tsplib_comm[] = {"-export", "-tsplib"};
+    char* gen_comm[] = {"-gen", "-generator"};
+    char* thread_comm[] = {"-threads", "-j"};
+    char* ls_comm[] = {"-ls", "-local_search"};
+    char* topk_comm[] = {"-topk", "-starts"};
+    char* init_comm[] = {"-init", "-construct"};
 //  char* warm_comm[] = {"-warm", "-w", "--warm"};
     char* perf_comm[] = {"-test", "-t"};
 //  char* tabu_comm[] = {"-tabu_par", "-tp"};
@@ -249,12 +333,26 @@ TSPenv* environment_new_cli(char** argv, const int argc) {
         if (strnin(argv[i], seed_comm, 3))  env->random_seed = abs(atoi(argv[++i])); 
 //      if (strnin(argv[i], warm_comm, 2))  env->warm = 1;  
         if (strnin(argv[i], perf_comm, 2))  env->perf_v = 1;
+        if (strnin(argv[i], mem_comm, 2))   env->mem_limit = fabs(atof(argv[++i]));
+        if (strnin(argv[i], dist_comm, 2))  env->dist_type = dist_type_parse(argv[++i]);
+        if (strnin(argv[i], renum_comm, 2)) env->renum = 1;
+        if (strnin(argv[i], layout_comm, 2)) env->dist_layout = dist_layout_parse(argv[++i]);
+        if (strnin(argv[i], cand_comm, 2))  env->cand_k = abs(atoi(argv[++i]));
+        if (strnin(argv[i], graph_comm, 2)) env->graph_q = abs(atoi(argv[++i]));
+        if (strnin(argv[i], bin_comm, 2))   strcpy(env->bin_file,argv[++i]);
+        if (strnin(argv[i], tsplib_comm, 2)) strcpy(env->tsplib_file,argv[++i]);
+        if (strnin(argv[i], gen_comm, 2))   env->gen_type = gen_type_parse(argv[++i]);
+        if (strnin(argv[i], thread_comm, 2)) env->num_threads = abs(atoi(argv[++i]));
+        if (strnin(argv[i], ls_comm, 2))    strcpy(env->ls_method,argv[++i]);
+        if (strnin(argv[i], topk_comm, 2))  env->topk = abs(atoi(argv[++i]));
+        if (strnin(argv[i], init_comm, 2))  strcpy(env->init_method,argv[++i]);
 //      if (strnin(argv[i], tabu_comm, 2))  env->tabu_par = abs(atoi(argv[++i]));  
 //      if (strnin(argv[i], vns_comm, 2))   env->vns_par = abs(atoi(argv[++i]));
         if (strnin(argv[i], help_comm, 3))  { help_info(); exit(0); }  
     }
 
     if(env->nnodes && env->random_seed) strcpy(env->file_name,"RND");
+    mt_pool_init(env->num_threads);
     return env; 
 }
 
@@ -263,7 +361,12 @@ TSPenv* environment_new_cli(char** argv, const int argc) {
 /// @param env instance of TSPenv
 void environment_delete(TSPenv* env) {
     free(env->file_name);
+    free(env->bin_file);
+    free(env->tsplib_file);
+    mt_pool_close();
     free(env->method);
+    free(env->ls_method);
+    free(env->init_method);
     free(env);
 
     #if VERBOSE > 1
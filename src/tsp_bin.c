@@ -0,0 +1,175 @@
+#include "../include/tsp_bin.h"
+#include <fcntl.h>
+
+#pragma region static_functions
+
+/// @brief offset of the next section, aligned to TSPB_ALIGN
+static inline uint64_t tspb_align(const uint64_t off) {
+    return (off + TSPB_ALIGN - 1) / TSPB_ALIGN * TSPB_ALIGN;
+}
+
+
+/// @brief write a section at a given offset, zero padding the gap before it
+/// @param f destination file
+/// @param pos current position inside the file
+/// @param off offset of the section
+/// @param data section content
+/// @param bytes section size
+static void tspb_put(FILE* f, uint64_t* pos, const uint64_t off, const void* data, const size_t bytes) {
+    static const char zero[TSPB_ALIGN] = { 0 };
+    if(off > *pos) fwrite(zero, 1, off - *pos, f);
+    if(fwrite(data, 1, bytes, f) != bytes) print_state(Error, " failed to write binary instance!");
+    *pos = off + bytes;
+}
+
+
+/// @brief true if a section [off, off + bytes) starts after the header, is aligned to TSPB_ALIGN
+///        and ends inside the file (no overflow on hostile offsets)
+static inline char tspb_section_ok(const uint64_t off, const uint64_t bytes, const uint64_t size) {
+    return off >= sizeof(tspb_header) && off % TSPB_ALIGN == 0 && bytes <= size && off <= size - bytes;
+}
+
+
+/// @brief true if a pointer lies inside the mapping of a binary instance
+static inline char tspb_owns(const TSPbin* bin, const void* ptr) {
+    return ptr != NULL && (const char*) ptr >= (const char*) bin->base && (const char*) ptr < (const char*) bin->base + bin->size;
+}
+
+#pragma endregion
+
+
+/// @brief check if a file is a binary instance (.tspb)
+/// @param file name of the file
+/// @return 1 if the file starts with the binary magic, 0 otherwise
+char tspb_detect(const char* file) {
+    FILE* f = fopen(file, "rb");
+    if(f == NULL) return 0;
+
+    char magic[8] = { 0 };
+    size_t read = fread(magic, 1, sizeof(magic), f);
+    fclose(f);
+
+    return read == sizeof(magic) && !memcmp(magic, TSPB_MAGIC, sizeof(magic));
+}
+
+
+/// @brief load a binary instance with mmap: coordinates, node ids, distance table and candidate
+///        lists point straight into the mapping (zero copies)
+/// @param inst instance of TSPinst
+/// @param env instance of TSPenv (the stored table / lists are used only if they match its settings)
+/// @param file name of .tspb file
+void tspb_load(TSPinst* inst, const TSPenv* env, const char* file) {
+    int fd = open(file, O_RDONLY);
+    if(fd < 0) print_state(Error, "input file not found!");
+
+    struct stat st;
+    if(fstat(fd, &st) || st.st_size < sizeof(tspb_header)) print_state(Error, " format error: truncated binary instance!");
+
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED) print_state(Error, " failed to map binary instance!");
+
+    const tspb_header* head = (const tspb_header*) base;
+    if(memcmp(head->magic, TSPB_MAGIC, sizeof(head->magic)) || head->version != TSPB_VERSION)
+        print_state(Error, " format error: unknown binary instance version!");
+
+    // every section is checked before it is attached: a truncated or corrupted file never reads past the mapping
+    const uint64_t size = st.st_size;
+    const uint64_t coord_bytes = (uint64_t) head->nnodes * sizeof(double);
+    if(!tspb_section_ok(head->x_off, coord_bytes, size) || !tspb_section_ok(head->y_off, coord_bytes, size) ||
+        (head->id_off && !tspb_section_ok(head->id_off, (uint64_t) head->nnodes * sizeof(int), size)) ||
+        (head->dist_off && !tspb_section_ok(head->dist_off, head->dist_bytes, size)) ||
+        (head->cand_off && !tspb_section_ok(head->cand_off, (uint64_t) head->nnodes * head->cand_k * sizeof(int), size)))
+        print_state(Error, " format error: truncated binary instance!");
+
+    inst->bin = (TSPbin*) malloc(sizeof(TSPbin));
+    inst->bin->base = base;
+    inst->bin->size = st.st_size;
+
+    char* raw = (char*) base;
+    inst->nnodes = head->nnodes;
+    inst->random_seed = head->random_seed;
+    inst->edge_type = head->edge_type;
+    inst->xcoord = (double*) (raw + head->x_off);
+    inst->ycoord = (double*) (raw + head->y_off);
+    if(head->id_off) inst->node_id = (int*) (raw + head->id_off);
+    inst->solution = malloc(inst->nnodes * sizeof(int));
+
+    // explicit weights cannot be recomputed: their table is used whatever the settings
+    if(head->dist_off && ((head->dist_type == env->dist_type && head->dist_layout == env->dist_layout) || head->edge_type == EXPLICIT))
+        inst->dist = dist_attach(inst, head->dist_type, head->dist_layout, raw + head->dist_off, head->dist_bytes);
+
+    unsigned int k = (env->cand_k < inst->nnodes) ? env->cand_k : inst->nnodes - 1;
+    if(head->cand_off && head->cand_k == k) {
+        inst->cand_k = k;
+        inst->cand = (int*) (raw + head->cand_off);
+    }
+
+    #if VERBOSE > 0
+        print_state(Info, "Binary instance mapped: %u nodes%s%s\n", inst->nnodes, (inst->dist != NULL) ? ", distances" : "", (inst->cand != NULL) ? ", candidates" : "");
+    #endif
+}
+
+
+/// @brief write an instance as a binary instance (.tspb): header, SoA coordinates, node ids
+///        and, when available, the full distance table and the candidate lists
+/// @param inst instance of TSPinst
+/// @param file name of the destination file
+void tspb_write(const TSPinst* inst, const char* file) {
+    FILE* f = fopen(file, "wb");
+    if(f == NULL) print_state(Error, " failed to open output file!");
+
+    const size_t coord_bytes = (size_t) inst->nnodes * sizeof(double);
+    const char store_dist = (inst->dist != NULL && inst->dist->mode == Full);
+
+    tspb_header head = { .version = TSPB_VERSION,
+                         .nnodes = inst->nnodes,
+                         .edge_type = inst->edge_type,
+                         .random_seed = inst->random_seed,
+                         .dist_type = store_dist ? inst->dist->type : -1,
+                         .dist_layout = store_dist ? inst->dist->layout : -1,
+                         .cand_k = (inst->cand != NULL) ? inst->cand_k : 0 };
+    memcpy(head.magic, TSPB_MAGIC, sizeof(head.magic));
+
+    uint64_t off = tspb_align(sizeof(tspb_header));
+    head.x_off = off;                               off = tspb_align(off + coord_bytes);
+    head.y_off = off;                               off = tspb_align(off + coord_bytes);
+    if(inst->node_id != NULL) { head.id_off = off;  off = tspb_align(off + inst->nnodes * sizeof(int)); }
+    if(store_dist) {
+        head.dist_off = off;
+        head.dist_bytes = inst->dist->bytes;
+        off = tspb_align(off + head.dist_bytes);
+    }
+    if(head.cand_k) head.cand_off = off;
+
+    uint64_t pos = 0;
+    tspb_put(f, &pos, 0, &head, sizeof(head));
+    tspb_put(f, &pos, head.x_off, inst->xcoord, coord_bytes);
+    tspb_put(f, &pos, head.y_off, inst->ycoord, coord_bytes);
+    if(head.id_off) tspb_put(f, &pos, head.id_off, inst->node_id, inst->nnodes * sizeof(int));
+    if(head.dist_off) tspb_put(f, &pos, head.dist_off, inst->dist->table.raw, head.dist_bytes);
+    if(head.cand_off) tspb_put(f, &pos, head.cand_off, inst->cand, (size_t) inst->nnodes * head.cand_k * sizeof(int));
+
+    fclose(f);
+
+    #if VERBOSE > 0
+        print_state(Info, "Binary instance written on %s (%.1f MB)\n", file, pos / (double)(1 << 20));
+    #endif
+}
+
+
+/// @brief unmap a binary instance: arrays pointing into the mapping are detached from TSPinst
+/// @param inst instance of TSPinst
+void tspb_close(TSPinst* inst) {
+    TSPbin* bin = inst->bin;
+    if(bin == NULL) return;
+
+    if(tspb_owns(bin, inst->xcoord))  inst->xcoord = NULL;
+    if(tspb_owns(bin, inst->ycoord))  inst->ycoord = NULL;
+    if(tspb_owns(bin, inst->node_id)) inst->node_id = NULL;
+    if(tspb_owns(bin, inst->cand))    inst->cand = NULL;
+
+    munmap(bin->base, bin->size);
+    free(bin);
+    inst->bin = NULL;
+}
@@ -0,0 +1,538 @@
+#include "../include/tsp_dist.h"
+
+#pragma region static_functions
+
+/// @brief raw distance between two nodes under the metric of the instance
+static inline double metric_dist(const TSPdist* dist, const unsigned int i, const unsigned int j) {
+    return (dist->metric == GEO) ? geo_dist(dist->x, dist->y, i, j) : soa_dist(dist->x, dist->y, i, j, dist->div);
+}
+
+
+/// @brief round a raw distance as required by the storage type (TSPLIB rounding of the metric for Int32)
+/// @param dist instance of TSPdist
+/// @param raw raw distance
+/// @return stored distance
+static inline double dist_round(const TSPdist* dist, const double raw) {
+    switch (dist->type) {
+        case Float:
+            return (float) raw;
+        case Int32:
+            return metric_round(dist->metric, raw);
+        default:
+            return raw;
+    }
+}
+
+#if !DIST_X86
+/// @brief fill one row of raw distances (scalar kernel)
+/// @param x x coordinates (SoA)
+/// @param y y coordinates (SoA)
+/// @param i row index
+/// @param div divisor of the squared distance
+/// @param row destination, row[j] = c_ij for j in [0,i]
+static void dist_row_scalar(const double* x, const double* y, const unsigned int i, const double div, double* row) {
+    for(unsigned int j = 0; j <= i; j++) {
+        row[j] = soa_dist(x, y, i, j, div);
+    }
+}
+#else
+/// @brief fill one row of raw distances, 2 arcs per instruction
+static void dist_row_sse2(const double* x, const double* y, const unsigned int i, const double div, double* row) {
+    const __m128d xi = _mm_set1_pd(x[i]);
+    const __m128d yi = _mm_set1_pd(y[i]);
+    const __m128d dv = _mm_set1_pd(div);
+
+    unsigned int j = 0;
+    for(; j + 2 <= i + 1; j += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + j), xi);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + j), yi);
+        __m128d sq = _mm_div_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), dv);
+        _mm_storeu_pd(row + j, _mm_sqrt_pd(sq));
+    }
+    for(; j <= i; j++) {
+        row[j] = soa_dist(x, y, i, j, div);
+    }
+}
+
+
+/// @brief fill one row of raw distances, 4 arcs per instruction
+__attribute__((target("avx2")))
+static void dist_row_avx2(const double* x, const double* y, const unsigned int i, const double div, double* row) {
+    const __m256d xi = _mm256_set1_pd(x[i]);
+    const __m256d yi = _mm256_set1_pd(y[i]);
+    const __m256d dv = _mm256_set1_pd(div);
+
+    unsigned int j = 0;
+    for(; j + 4 <= i + 1; j += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), xi);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), yi);
+        __m256d sq = _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), dv);
+        _mm256_storeu_pd(row + j, _mm256_sqrt_pd(sq));
+    }
+    for(; j <= i; j++) {
+        row[j] = soa_dist(x, y, i, j, div);
+    }
+}
+#endif
+
+
+/// @brief fill one row of raw TSPLIB GEO distances (scalar kernel)
+static void dist_row_geo(const double* x, const double* y, const unsigned int i, const double div, double* row) {
+    for(unsigned int j = 0; j <= i; j++) {
+        row[j] = (j == i) ? 0 : geo_dist(x, y, i, j);
+    }
+}
+
+
+/// @brief pick the widest row kernel supported by the running cpu
+/// @param metric edge weight type (GEO has only a scalar kernel)
+/// @return row kernel
+static dist_row_fun dist_row_kernel(const int metric) {
+    if(metric == GEO) return dist_row_geo;
+
+    #if DIST_X86
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2")) return dist_row_avx2;
+        return dist_row_sse2;
+    #else
+        return dist_row_scalar;
+    #endif
+}
+
+
+/// @brief narrow a row of raw distances into the table (one contiguous segment per tile, vectorized by the compiler)
+/// @param dist instance of TSPdist (Full mode)
+/// @param i row index
+/// @param raw raw distances c_ij for j in [0,i]
+static void dist_store_row(TSPdist* dist, const unsigned int i, const double* raw) {
+    for(unsigned int j0 = 0, j1; j0 <= i; j0 = j1) {
+        j1 = (dist->layout == Tiled) ? ((j0 >> DIST_TILE_BITS) + 1) << DIST_TILE_BITS : i + 1;
+        if(j1 > i + 1) j1 = i + 1;
+
+        const size_t q = dist_index(dist, i, j0);
+        const unsigned int len = j1 - j0;
+        const double* src = raw + j0;
+
+        switch (dist->type) {
+            case Float:
+                for(unsigned int k = 0; k < len; k++) dist->table.f[q + k] = (float) src[k];
+                break;
+
+            case Int32:
+                if(dist->metric == EUC_2D || dist->metric == ATT) {
+                    for(unsigned int k = 0; k < len; k++) dist->table.i[q + k] = (int32_t) (src[k] + 0.5);
+                    if(dist->metric == ATT)
+                        for(unsigned int k = 0; k < len; k++) dist->table.i[q + k] += (dist->table.i[q + k] < src[k]);
+                }
+                else for(unsigned int k = 0; k < len; k++) dist->table.i[q + k] = metric_round(dist->metric, src[k]);
+                break;
+
+            default:
+                for(unsigned int k = 0; k < len; k++) dist->table.d[q + k] = src[k];
+                break;
+        }
+    }
+}
+
+
+/// @brief worker: claim blocks of DIST_ROW_BLOCK rows until the table is full
+/// @param userhandle pointer to mt_dist_pars
+static void* dist_table_job(void* userhandle) {
+    mt_dist_pars* pars = (mt_dist_pars*) userhandle;
+    TSPdist* dist = pars->mt_dist;
+
+    // rows of doubles are written in place, every other case goes through a raw row
+    char in_place = (dist->type == Double && dist->layout == Rows);
+    double* raw = in_place ? NULL : (double*) malloc(pars->mt_nnodes * sizeof(double));
+
+    unsigned int start;
+    while((start = __atomic_fetch_add(&pars->mt_next_row, DIST_ROW_BLOCK, __ATOMIC_RELAXED)) < pars->mt_nnodes) {
+        unsigned int end = (start + DIST_ROW_BLOCK < pars->mt_nnodes) ? start + DIST_ROW_BLOCK : pars->mt_nnodes;
+
+        for(unsigned int i = start; i < end; i++) {
+            if(in_place) {
+                pars->mt_row_fun(dist->x, dist->y, i, dist->div, dist->table.d + DIST_ROW(i));
+                continue;
+            }
+            pars->mt_row_fun(dist->x, dist->y, i, dist->div, raw);
+            dist_store_row(dist, i, raw);
+        }
+    }
+
+    free(raw);
+    return NULL;
+}
+
+
+/// @brief fill the whole distance table in parallel
+/// @param dist instance of TSPdist (Full mode, table allocated)
+/// @param nnodes number of nodes
+static void dist_table_fill(TSPdist* dist, const unsigned int nnodes) {
+    int num_threads = mt_pool_size();
+    int max_threads = (nnodes + DIST_ROW_BLOCK - 1) / DIST_ROW_BLOCK;
+    if(num_threads > max_threads) num_threads = max_threads;
+    if(num_threads < 1) num_threads = 1;
+
+    mt_dist_pars dist_par = {   .mt_dist = dist,
+                                .mt_nnodes = nnodes,
+                                .mt_row_fun = dist_row_kernel(dist->metric),
+                                .mt_next_row = 0 };
+
+    mt_context* dist_ctx = new_mt_context(num_threads, !HANDLE_MTX);
+    run_job(dist_ctx, dist_table_job, &dist_par);
+    delete_mt_context(dist_ctx, !HANDLE_MTX);
+
+    #if VERBOSE > 1
+        print_state(Info, "Distance table (%zu arcs) built on %d threads\n", dist_table_size(nnodes), num_threads);
+    #endif
+}
+
+
+/// @brief interleave the bits of two coordinates (Morton / Z-order code)
+static uint64_t morton_code(const uint32_t x, const uint32_t y) {
+    uint64_t code = 0;
+    for(int b = 0; b < 32; b++) {
+        code |= (uint64_t) ((x >> b) & 1) << (2 * b);
+        code |= (uint64_t) ((y >> b) & 1) << (2 * b + 1);
+    }
+    return code;
+}
+
+
+typedef struct {
+    uint64_t    code;
+    uint32_t    tile;
+} tile_key;
+
+static int tile_ascending(const void* elem1, const void* elem2) {
+    uint64_t f = ((tile_key*) elem1)->code;
+    uint64_t s = ((tile_key*) elem2)->code;
+    return (f > s) - (f < s);
+}
+
+
+/// @brief rank every tile (I,J), I >= J, along the Morton curve
+/// @param dist instance of TSPdist
+/// @param ntiles number of tiles per side
+static void dist_tile_rank(TSPdist* dist, const unsigned int ntiles) {
+    tile_key* keys = (tile_key*) malloc(DIST_ROW(ntiles) * sizeof(tile_key));
+    dist->tile_rank = (uint32_t*) malloc(DIST_ROW(ntiles) * sizeof(uint32_t));
+
+    for(unsigned int I = 0; I < ntiles; I++)
+        for(unsigned int J = 0; J <= I; J++)
+            keys[DIST_ROW(I) + J] = (tile_key) { .code = morton_code(J, I), .tile = DIST_ROW(I) + J };
+    qsort(keys, DIST_ROW(ntiles), sizeof(tile_key), tile_ascending);
+
+    for(uint32_t r = 0; r < DIST_ROW(ntiles); r++) dist->tile_rank[keys[r].tile] = r;
+    free(keys);
+}
+
+
+/// @brief size in bytes of one stored distance
+static size_t dist_elem_size(const int type) {
+    switch (type) {
+        case Float: return sizeof(float);
+        case Int32: return sizeof(int32_t);
+        default:    return sizeof(double);
+    }
+}
+
+
+/// @brief pick the storage mode fitting the memory budget
+/// @param dist instance of TSPdist
+/// @param nnodes number of nodes
+/// @param budget memory budget in bytes
+static void dist_mode_select(TSPdist* dist, const unsigned int nnodes, const double budget) {
+    const size_t ntiles = (nnodes + DIST_TILE - 1) >> DIST_TILE_BITS;
+    size_t entries = (dist->layout == Tiled) ? DIST_ROW(ntiles) * DIST_TILE * DIST_TILE : dist_table_size(nnodes);
+    size_t full_bytes = entries * dist_elem_size(dist->type);
+
+    if(full_bytes <= budget) {
+        dist->mode = Full;
+        dist->bytes = full_bytes;
+    }
+    else if(budget >= DIST_CACHE_MIN) {
+        dist->mode = Cache;
+        dist->cache_sets = 1;
+        while((dist->cache_sets << 1) * DIST_CACHE_WAYS * sizeof(dist_slot) <= budget) dist->cache_sets <<= 1;
+        dist->bytes = dist->cache_sets * DIST_CACHE_WAYS * sizeof(dist_slot);
+    }
+    else {
+        dist->mode = OnTheFly;
+        dist->bytes = 0;
+    }
+}
+
+
+/// @brief common setup of a distance oracle (no storage allocated)
+/// @param inst instance of TSPinst
+/// @param type storage type
+/// @param layout table layout
+/// @return an instance of TSPdist
+static TSPdist* dist_init(const TSPinst* inst, const int type, const int layout) {
+    if(inst->nnodes <= 1) print_state(Error, "Impossible to build distances for less than 2 nodes\n");
+
+    TSPdist* dist = (TSPdist*) calloc(1, sizeof(TSPdist));
+    dist->x = inst->xcoord;
+    dist->y = inst->ycoord;
+    dist->type = type;
+    dist->layout = layout;
+    dist->metric = inst->edge_type;
+
+    // ATT is pseudo-euclidean for every storage type, TSPLIB rounding only applies to integer costs
+    dist->div = (dist->metric == ATT) ? 10.0 : 1.0;
+    dist->eps = (dist->type == Int32) ? 0.5 : EPSILON;
+    return dist;
+}
+
+
+/// @brief distance kernel specialized for the storage, layout, type and metric of an oracle
+/// @param dist instance of TSPdist (storage already selected)
+/// @return kernel index (see DIST_KERNELS)
+static int dist_kernel_select(const TSPdist* dist) {
+    if(dist->mode == Full) {
+        switch (dist->type) {
+            case Int32: return (dist->layout == Tiled) ? Kernel_tiled_i : Kernel_rows_i;
+            case Float: return (dist->layout == Tiled) ? Kernel_tiled_f : Kernel_rows_f;
+            default:    return (dist->layout == Tiled) ? Kernel_tiled_d : Kernel_rows_d;
+        }
+    }
+    if(dist->mode == Cache || dist->type == Float || dist->metric == EXPLICIT) return Kernel_lookup;
+
+    if(dist->type == Int32) {
+        switch (dist->metric) {
+            case ATT:       return Kernel_att_i;
+            case CEIL_2D:   return Kernel_ceil_i;
+            case GEO:       return Kernel_geo_i;
+            default:        return Kernel_euc_i;
+        }
+    }
+    return (dist->metric == GEO) ? Kernel_geo_d : Kernel_euc_d;
+}
+
+
+/// @brief hash of an arc key (fibonacci hashing)
+static inline uint64_t dist_hash(const uint64_t key) {
+    return key * 0x9E3779B97F4A7C15ULL;
+}
+
+#pragma endregion
+
+
+/// @brief number of entries of the distance table (lower triangle, diagonal included)
+/// @param nnodes number of nodes
+/// @return number of distances stored
+size_t dist_table_size(const unsigned int nnodes) {
+    return DIST_ROW(nnodes);
+}
+
+
+/// @brief build the distance oracle of an instance
+/// @param inst instance of TSPinst (points and SoA coordinates already loaded)
+/// @param env instance of TSPenv (memory budget in MB, storage type and layout)
+/// @return an instance of TSPdist
+TSPdist* dist_new(const TSPinst* inst, const TSPenv* env) {
+    TSPdist* dist = dist_init(inst, env->dist_type, env->dist_layout);
+
+    dist_mode_select(dist, inst->nnodes, env->mem_limit * (1 << 20));
+
+    switch (dist->mode) {
+        case Full:
+            if(dist->layout == Tiled) dist_tile_rank(dist, (inst->nnodes + DIST_TILE - 1) >> DIST_TILE_BITS);
+            dist->table.raw = malloc(dist->bytes);
+            if (dist->table.raw == NULL) print_state(Error, " failed to allocate memory for distance table!");
+            dist_table_fill(dist, inst->nnodes);
+            break;
+
+        case Cache:
+            dist->cache = (dist_slot*) aligned_alloc(DIST_CACHE_WAYS * sizeof(dist_slot), dist->bytes);
+            if (dist->cache == NULL) print_state(Error, " failed to allocate memory for distance cache!");
+            memset(dist->cache, 0, dist->bytes);
+            break;
+
+        default: break;
+    }
+
+    dist->kernel = dist_kernel_select(dist);
+
+    #if VERBOSE > 0
+        print_state(Info, "Distance oracle: %s%s (%.1f MB)\n", dist_mode_name(dist), (dist->mode == Full && dist->layout == Tiled) ? " TILED" : "", dist->bytes / (double)(1 << 20));
+    #endif
+
+    return dist;
+}
+
+
+/// @brief build a full-table distance oracle over an already computed table (e.g. memory mapped)
+/// @param inst instance of TSPinst (SoA coordinates already loaded)
+/// @param type storage type of the table
+/// @param layout layout of the table
+/// @param table distance table (not owned: dist_delete does not free it)
+/// @param bytes size of the table
+/// @return an instance of TSPdist, NULL if the table size does not match the instance
+TSPdist* dist_attach(const TSPinst* inst, const int type, const int layout, void* table, const size_t bytes) {
+    TSPdist* dist = dist_init(inst, type, layout);
+
+    dist_mode_select(dist, inst->nnodes, INFINITY);
+    if(dist->bytes != bytes) { free(dist); return NULL; }
+
+    if(dist->layout == Tiled) dist_tile_rank(dist, (inst->nnodes + DIST_TILE - 1) >> DIST_TILE_BITS);
+    dist->table.raw = table;
+    dist->mapped = 1;
+    dist->kernel = dist_kernel_select(dist);
+
+    #if VERBOSE > 0
+        print_state(Info, "Distance oracle: %s%s (%.1f MB, mapped)\n", dist_mode_name(dist), (dist->layout == Tiled) ? " TILED" : "", dist->bytes / (double)(1 << 20));
+    #endif
+
+    return dist;
+}
+
+
+/// @brief build an empty full-table distance oracle to be filled arc by arc (EXPLICIT weights)
+/// @param inst instance of TSPinst (nnodes known)
+/// @param env instance of TSPenv (storage type and layout, the memory budget cannot be honored)
+/// @return an instance of TSPdist with every distance set to 0
+TSPdist* dist_explicit_new(const TSPinst* inst, const TSPenv* env) {
+    TSPdist* dist = dist_init(inst, env->dist_type, env->dist_layout);
+    dist->metric = EXPLICIT;
+
+    dist_mode_select(dist, inst->nnodes, INFINITY);
+    if(dist->bytes > env->mem_limit * (1 << 20)) print_state(Warn, "explicit weights need the full table (%.1f MB), memory limit ignored\n", dist->bytes / (double)(1 << 20));
+
+    if(dist->layout == Tiled) dist_tile_rank(dist, (inst->nnodes + DIST_TILE - 1) >> DIST_TILE_BITS);
+    dist->table.raw = calloc(1, dist->bytes);
+    if (dist->table.raw == NULL) print_state(Error, " failed to allocate memory for distance table!");
+    dist->kernel = dist_kernel_select(dist);
+
+    return dist;
+}
+
+
+/// @brief store the distance of the arc i->j (Full mode only)
+/// @param dist instance of TSPdist
+/// @param i node of index i
+/// @param j node of index j
+/// @param value distance (rounded as the storage type requires)
+void dist_store(TSPdist* dist, const unsigned int i, const unsigned int j, const double value) {
+    const unsigned int hi = (i > j) ? i : j;
+    const unsigned int lo = (i > j) ? j : i;
+    const size_t q = dist_index(dist, hi, lo);
+    switch (dist->type) {
+        case Int32: dist->table.i[q] = metric_round(dist->metric, value); break;
+        case Float: dist->table.f[q] = (float) value; break;
+        default:    dist->table.d[q] = value; break;
+    }
+}
+
+
+/// @brief pin the arcs (l, l+1 mod n) flagged in pinned to DIST_PINNED, a cost so negative that no
+///        local search removes them (the oracle falls back to the generic lookup kernel)
+/// @param dist instance of TSPdist (Cache or OnTheFly mode)
+/// @param pinned pinned[l] is 1 if the arc (l, l+1 mod n) is pinned (not owned)
+/// @param n number of nodes
+void dist_pin(TSPdist* dist, const char* pinned, const unsigned int n) {
+    if(dist->mode == Full) print_state(Error, "Pinned arcs need an oracle without full table\n");
+    dist->pinned = pinned;
+    dist->pinned_n = n;
+    dist->kernel = Kernel_lookup;
+}
+
+
+/// @brief free memory of an instance of TSPdist
+/// @param dist instance of TSPdist
+void dist_delete(TSPdist* dist) {
+    if(dist == NULL) return;
+    if(!dist->mapped) free(dist->table.raw);
+    free(dist->tile_rank);
+    free(dist->cache);
+    free(dist);
+}
+
+
+/// @brief get distance of the arc i->j when the full table is not stored
+/// @param dist instance of TSPdist (Cache or OnTheFly mode)
+/// @param i node of index i
+/// @param j node of index j
+/// @return distance between i and j (rounded as the storage type requires)
+double dist_lookup(const TSPdist* dist, const unsigned int i, const unsigned int j) {
+    const unsigned int hi = (i > j) ? i : j;
+    const unsigned int lo = (i > j) ? j : i;
+
+    if(dist->pinned != NULL)
+        if((hi == lo + 1 && dist->pinned[lo]) || (lo == 0 && hi == dist->pinned_n - 1 && dist->pinned[hi])) return DIST_PINNED;
+
+    if(dist->mode != Cache) return dist_round(dist, metric_dist(dist, i, j));
+
+    const uint64_t key = DIST_ROW(hi) + lo + 1;
+    const uint64_t hash = dist_hash(key);
+    dist_slot* set = dist->cache + (hash >> 32) % dist->cache_sets * DIST_CACHE_WAYS;
+
+    // slot tag = busy bit | version | key: a reader accepts the value only if the tag is unchanged around the load
+    for(int w = 0; w < DIST_CACHE_WAYS; w++) {
+        uint64_t tag = __atomic_load_n(&set[w].tag, __ATOMIC_ACQUIRE);
+        if((tag & (DIST_SLOT_BUSY | DIST_SLOT_KEY)) != key) continue;
+
+        double value;
+        __atomic_load(&set[w].dist, &value, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&set[w].tag, __ATOMIC_RELAXED) == tag) return value;
+        break;
+    }
+
+    double value = dist_round(dist, metric_dist(dist, i, j));
+
+    dist_slot* victim = set + (hash & (DIST_CACHE_WAYS - 1));
+    uint64_t old = __atomic_load_n(&victim->tag, __ATOMIC_RELAXED);
+    if(old & DIST_SLOT_BUSY) return value;
+    if(!__atomic_compare_exchange_n(&victim->tag, &old, old | DIST_SLOT_BUSY, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return value;
+    // the busy tag must be visible before the new distance (seqlock writer)
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    __atomic_store(&victim->dist, &value, __ATOMIC_RELAXED);
+    uint64_t version = ((old & ~DIST_SLOT_BUSY) + DIST_SLOT_VER) & ~(DIST_SLOT_BUSY | DIST_SLOT_KEY);
+    __atomic_store_n(&victim->tag, version | key, __ATOMIC_RELEASE);
+
+    return value;
+}
+
+
+/// @brief name of the storage mode used by the oracle
+/// @param dist instance of TSPdist
+/// @return mode name
+char* dist_mode_name(const TSPdist* dist) {
+    switch (dist->mode) {
+        case Full:      return "FULL";
+        case Cache:     return "CACHE";
+        case OnTheFly:  return "ON-THE-FLY";
+        default:        return "";
+    }
+}
+
+
+/// @brief parse the storage type given by cli
+/// @param name DOUBLE, FLOAT or INT
+/// @return storage type
+int dist_type_parse(const char* name) {
+    char* flt_type[] = {"FLOAT", "F32"};
+    char* int_type[] = {"INT", "INT32", "I32"};
+    char* dbl_type[] = {"DOUBLE", "F64"};
+
+    if(strnin(name, flt_type, 2)) return Float;
+    if(strnin(name, int_type, 3)) return Int32;
+    if(!strnin(name, dbl_type, 2)) print_state(Error, "Distance type %s not implemented!\n", name);
+    return Double;
+}
+
+
+/// @brief parse the table layout given by cli
+/// @param name ROWS or TILED
+/// @return table layout
+int dist_layout_parse(const char* name) {
+    char* tiled_layout[] = {"TILED", "TILE", "MORTON"};
+    char* rows_layout[] = {"ROWS", "ROW"};
+
+    if(strnin(name, tiled_layout, 3)) return Tiled;
+    if(!strnin(name, rows_layout, 2)) print_state(Error, "Distance layout %s not implemented!\n", name);
+    return Rows;
+}
@@ -0,0 +1,264 @@
+#include "../include/tsp_solver.h"
+
+#pragma region static_functions
+
+/// @brief worker: claim blocks of EDGE_BLOCK edges and count the digits of the current pass
+/// @param userhandle pointer to mt_edge_pars
+static void* edge_count_job(void* userhandle) {
+    mt_edge_pars* pars = (mt_edge_pars*) userhandle;
+
+    unsigned int b;
+    while((b = __atomic_fetch_add(&pars->mt_next_block, 1, __ATOMIC_RELAXED)) < pars->mt_nblocks) {
+        size_t* count = pars->mt_count + (size_t) b * EDGE_RADIX;
+        size_t end = ((size_t) (b + 1) * EDGE_BLOCK < pars->mt_nedges) ? (size_t) (b + 1) * EDGE_BLOCK : pars->mt_nedges;
+
+        memset(count, 0, EDGE_RADIX * sizeof(size_t));
+        for(size_t e = (size_t) b * EDGE_BLOCK; e < end; e++) count[(pars->mt_src[e].key >> pars->mt_shift) & (EDGE_RADIX - 1)]++;
+    }
+    return NULL;
+}
+
+
+/// @brief worker: claim blocks of EDGE_BLOCK edges and move them to the offsets of their digit,
+///        keeping their order inside the block (stable)
+/// @param userhandle pointer to mt_edge_pars
+static void* edge_scatter_job(void* userhandle) {
+    mt_edge_pars* pars = (mt_edge_pars*) userhandle;
+
+    unsigned int b;
+    while((b = __atomic_fetch_add(&pars->mt_next_block, 1, __ATOMIC_RELAXED)) < pars->mt_nblocks) {
+        size_t* offset = pars->mt_count + (size_t) b * EDGE_RADIX;
+        size_t end = ((size_t) (b + 1) * EDGE_BLOCK < pars->mt_nedges) ? (size_t) (b + 1) * EDGE_BLOCK : pars->mt_nedges;
+
+        for(size_t e = (size_t) b * EDGE_BLOCK; e < end; e++) {
+            const edge_item item = pars->mt_src[e];
+            pars->mt_dst[offset[(item.key >> pars->mt_shift) & (EDGE_RADIX - 1)]++] = item;
+        }
+    }
+    return NULL;
+}
+
+
+/// @brief stable LSD radix sort of the edges by key on the thread pool (EDGE_RADIX_BITS per pass,
+///        a pass is skipped when every edge has the same digit): the order does not depend on
+///        the number of threads
+/// @param edges edges to sort
+/// @param buffer scratch array of the same size
+/// @param nedges number of edges
+/// @return the array (edges or buffer) holding the sorted edges
+static edge_item* edge_sort(edge_item* edges, edge_item* buffer, const size_t nedges) {
+    const unsigned int nblocks = (nedges + EDGE_BLOCK - 1) / EDGE_BLOCK;
+    size_t* count = (size_t*) malloc((size_t) nblocks * EDGE_RADIX * sizeof(size_t));
+
+    mt_context* edge_ctx = new_mt_context(mt_pool_size(), !HANDLE_MTX);
+
+    for(unsigned int shift = 0; shift < 64; shift += EDGE_RADIX_BITS) {
+        mt_edge_pars edge_par = {   .mt_src = edges,
+                                    .mt_dst = buffer,
+                                    .mt_nedges = nedges,
+                                    .mt_shift = shift,
+                                    .mt_count = count,
+                                    .mt_nblocks = nblocks,
+                                    .mt_next_block = 0 };
+        run_job(edge_ctx, edge_count_job, &edge_par);
+
+        // offsets: digit by digit, and block by block inside a digit
+        size_t sum = 0;
+        char skip = 0;
+        for(unsigned int d = 0; d < EDGE_RADIX; d++) {
+            size_t total = 0;
+            for(unsigned int b = 0; b < nblocks; b++) {
+                size_t c = count[(size_t) b * EDGE_RADIX + d];
+                count[(size_t) b * EDGE_RADIX + d] = sum;
+                sum += c;
+                total += c;
+            }
+            if(total == nedges) skip = 1;
+        }
+        if(skip) continue;
+
+        edge_par.mt_next_block = 0;
+        run_job(edge_ctx, edge_scatter_job, &edge_par);
+
+        edge_item* tmp = edges;
+        edges = buffer;
+        buffer = tmp;
+    }
+
+    delete_mt_context(edge_ctx, !HANDLE_MTX);
+    free(count);
+    return edges;
+}
+
+
+/// @brief worker: claim blocks of EDGE_NODE_BLOCK nodes and write the edges of their candidate
+///        lists, every pair once, keyed by the bits of their length (non-negative doubles sort
+///        as unsigned integers); a pair already taken from the other list gets EDGE_NONE
+/// @param userhandle pointer to mt_collect_pars
+static void* edge_collect_job(void* userhandle) {
+    mt_collect_pars* pars = (mt_collect_pars*) userhandle;
+    const unsigned int k = pars->mt_k;
+    const int* cand = pars->mt_cand;
+
+    unsigned int start;
+    while((start = __atomic_fetch_add(&pars->mt_next_node, EDGE_NODE_BLOCK, __ATOMIC_RELAXED)) < pars->mt_inst->nnodes) {
+        unsigned int end = (start + EDGE_NODE_BLOCK < pars->mt_inst->nnodes) ? start + EDGE_NODE_BLOCK : pars->mt_inst->nnodes;
+
+        for(int i = start; i < end; i++) {
+            for(unsigned int h = 0; h < k; h++) {
+                const int j = cand[(size_t) i * k + h];
+                edge_item* edge = &pars->mt_edges[(size_t) i * k + h];
+
+                // (i,j) is taken from the list of the smaller node, or from the only list holding it
+                char dup = 0;
+                if(j < i) for(unsigned int l = 0; l < k && !dup; l++) dup = (cand[(size_t) j * k + l] == i);
+
+                *edge = (edge_item) { .key = EDGE_NONE, .u = i, .v = j };
+                if(dup) continue;
+
+                double d = get_arc(pars->mt_inst, i, j);
+                memcpy(&edge->key, &d, sizeof(uint64_t));
+            }
+        }
+    }
+    return NULL;
+}
+
+
+/// @brief root of a node in the union-find forest (path halving)
+static inline int edge_find(int* root, int i) {
+    while(root[i] != i) i = root[i] = root[root[i]];
+    return i;
+}
+
+
+/// @brief nearest free fragment end by a linear scan (no planar geometry)
+/// @param inst instance of TSPinst
+/// @param deg degree of every node in the fragments
+/// @param used nodes already in the tour
+/// @param i reference node
+/// @return nearest end, -1 if none is left
+static int edge_nearest_end(const TSPinst* inst, const char* deg, const char* used, const int i) {
+    double best_dist = INFINITY;
+    int best = -1;
+
+    for(int j = 0; j < inst->nnodes; j++) {
+        if(used[j] || deg[j] == 2) continue;
+        double d = get_arc(inst, i, j);
+        if(d < best_dist) { best_dist = d; best = j; }
+    }
+    return best;
+}
+
+#pragma endregion
+
+
+/// @brief find a solution to TSP with the greedy edge heuristic: the candidate edges are sorted by
+///        length and taken when both ends have degree < 2 and they close no cycle (union-find);
+///        the fragments are then chained from the end of one to the nearest free end of another
+/// @param inst instance of TSPinst
+/// @param env instance of TSPenv
+/// @param tsp_func improvement function
+/// @param func_name name of the improvement function
+/// @param init_time starting time
+TSPsol TSPgreedy_edge(const TSPinst* inst, const TSPenv* env, void(tsp_func)(const TSPinst*, const TSPenv*,double, int*, double*), char* func_name, double init_time) {
+    const unsigned int n = inst->nnodes;
+
+    // without candidate lists (-k 0) the default ones are built for the edges
+    unsigned int k = inst->cand_k;
+    int* cand = inst->cand;
+    if(cand == NULL || k == 0) {
+        k = (CAND_SIZE < n) ? CAND_SIZE : n - 1;
+        cand = cand_new(inst, k);
+    }
+
+    edge_item* edges = (edge_item*) malloc((size_t) n * k * sizeof(edge_item));
+    edge_item* buffer = (edge_item*) malloc((size_t) n * k * sizeof(edge_item));
+    const size_t m = (size_t) n * k;
+
+    mt_collect_pars collect_par = { .mt_inst = inst,
+                                    .mt_cand = cand,
+                                    .mt_k = k,
+                                    .mt_edges = edges,
+                                    .mt_next_node = 0 };
+
+    mt_context* collect_ctx = new_mt_context(mt_pool_size(), !HANDLE_MTX);
+    run_job(collect_ctx, edge_collect_job, &collect_par);
+    delete_mt_context(collect_ctx, !HANDLE_MTX);
+
+    const edge_item* sorted = edge_sort(edges, buffer, m);
+
+    int* adj = (int*) malloc(2 * n * sizeof(int));
+    int* root = (int*) malloc(n * sizeof(int));
+    char* deg = (char*) calloc(n, sizeof(char));
+    for(int i = 0; i < n; i++) { adj[2 * i] = adj[2 * i + 1] = -1; root[i] = i; }
+
+    unsigned int taken = 0;
+    for(size_t e = 0; e < m && taken < n - 1 && sorted[e].key != EDGE_NONE; e++) {
+        const int u = sorted[e].u, v = sorted[e].v;
+        if(deg[u] == 2 || deg[v] == 2) continue;
+
+        int ru = edge_find(root, u), rv = edge_find(root, v);
+        if(ru == rv) continue;
+        root[ru] = rv;
+
+        adj[2 * u + deg[u]++] = v;
+        adj[2 * v + deg[v]++] = u;
+        taken++;
+    }
+    free(edges);
+    free(buffer);
+    free(root);
+    if(cand != inst->cand) free(cand);
+
+    // chain the fragments: walk one to its other end, then jump to the nearest free end
+    TSPsol out = { .cost = 0.0, .tour = malloc(n * sizeof(int)) };
+    char* used = (char*) calloc(n, sizeof(char));
+
+    kd_query* ends = NULL;
+    if(inst->kdtree != NULL) {
+        ends = kdquery_new(inst->kdtree);
+        for(int i = 0; i < n; i++) if(deg[i] == 2) kdquery_remove(ends, i);
+    }
+
+    int x = 0;
+    while(deg[x] == 2) x++;
+
+    unsigned int pos = 0;
+    for(;;) {
+        int prev = -1;
+        for(;;) {
+            out.tour[pos++] = x;
+            used[x] = 1;
+            if(ends != NULL) kdquery_remove(ends, x);
+
+            int next = (adj[2 * x] != prev) ? adj[2 * x] : adj[2 * x + 1];
+            if(next < 0) break;
+            prev = x;
+            x = next;
+        }
+        if(pos == n) break;
+        x = (ends != NULL) ? kdquery_nearest(ends, x, NULL) : edge_nearest_end(inst, deg, used, x);
+    }
+
+    for(int i = 0; i < n; i++) out.cost += get_arc(inst, out.tour[i], out.tour[(i + 1 < n) ? i + 1 : 0]);
+
+    if(ends != NULL) kdquery_delete(ends);
+    free(used);
+    free(deg);
+    free(adj);
+
+    #if VERBOSE > 1
+    printf("Partial \e[1m%7s\e[m solution from %u fragments: \t%10.4f\n", "G_EDGE", n - taken, out.cost);
+    #endif
+
+    if(tsp_func != NULL) {
+        tsp_func(inst, env, init_time, out.tour, &out.cost);
+
+        #if VERBOSE > 1
+        printf("Partial \e[1m%7s\e[m solution from the greedy edge tour: \t%10.4f\n", func_name, out.cost);
+        #endif
+    }
+
+    return out;
+}
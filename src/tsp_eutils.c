@@ -1,10 +1,88 @@
 #include "../include/tsp_eutils.h"
 
+#pragma region static_functions
+
+/// @brief ends of the edge stored in a column of the CPLEX model
+/// @param inst TSPinst instance pointer
+/// @param xpos index of the column
+/// @param i first end (i < j)
+/// @param j second end
+static void CPLEX_xcoords(const TSPinst* inst, const size_t xpos, int* i, int* j) {
+	const TSPgraph* graph = inst->graph;
+	if(graph != NULL) {
+		if(xpos < graph->nedges) { *i = graph->edge_u[xpos]; *j = graph->edge_v[xpos]; }
+		else { *i = graph->extra[xpos - graph->nedges] >> 32; *j = graph->extra[xpos - graph->nedges] & UINT32_MAX; }
+		return;
+	}
+
+	// full model: last row whose first column x(r,r+1) is not after xpos
+	int lo = 0, hi = inst->nnodes - 2;
+	while(lo < hi) {
+		int mid = lo + (hi - lo + 1) / 2;
+		if(coords_to_index(inst->nnodes, mid, mid+1) <= xpos) lo = mid;
+		else hi = mid - 1;
+	}
+	*i = lo;
+	*j = lo + 1 + (xpos - coords_to_index(inst->nnodes, lo, lo+1));
+}
+
+
+/// @brief SEC of a set of nodes: one coefficient for every column with both ends in the set
+/// @param inst TSPinst instance pointer
+/// @param nodes nodes of the set
+/// @param size number of nodes in the set
+/// @param index columns of the non-zeros
+/// @param value non-zeros
+/// @return number of non-zeros
+static int SEC_row(const TSPinst* inst, const int* nodes, const int size, int* index, double* value) {
+	int nnz = 0;
+	if(inst->graph == NULL) {
+		for(int i = 0; i < size; i++) {
+			for(int j = i+1; j < size; j++) {
+				index[nnz] = coords_to_index(inst->nnodes, nodes[i], nodes[j]);
+				value[nnz] = 1.0;
+				nnz++;
+			}
+		}
+		return nnz;
+	}
+
+	// candidate edges leaving every node of the set, then the columns added outside the graph
+	const TSPgraph* graph = inst->graph;
+	char* in_set = (char*) calloc(inst->nnodes, sizeof(char));
+	for(int i = 0; i < size; i++) in_set[nodes[i]] = 1;
+
+	for(int i = 0; i < size; i++) {
+		for(size_t a = graph->start[nodes[i]]; a < graph->start[nodes[i]+1]; a++) {
+			int j = graph->adj[a];
+			if(j < nodes[i] || !in_set[j]) continue;
+			index[nnz] = graph_edge_index(graph, nodes[i], j);
+			value[nnz] = 1.0;
+			nnz++;
+		}
+	}
+	for(size_t c = 0; c < graph->nextra; c++) {
+		if(!in_set[graph->extra[c] >> 32] || !in_set[graph->extra[c] & UINT32_MAX]) continue;
+		index[nnz] = graph->nedges + c;
+		value[nnz] = 1.0;
+		nnz++;
+	}
+
+	free(in_set);
+	return nnz;
+}
+
+#pragma endregion
+
 /// @brief Create a CPLEX problem (env,lp) from a TSP instance
 /// @param inst TSPinst instance pointer
 /// @param env CPLEX environment pointer
 /// @param lp CPLEX model pointer
 void CPLEX_model_new(TSPinst* inst, CPXENVptr* env, CPXLPptr* lp) {
+	// CPLEX indexes columns with int: one column per edge (per candidate edge with a graph)
+	size_t nedges = (inst->graph != NULL) ? inst->graph->nedges : EDGE_COUNT(inst->nnodes);
+	if(nedges > INT_MAX) print_state(Error, "instance too large for a CPLEX model, use a heuristic method!");
+
 	//Env and empty model created
 	int error;
 	*env = CPXopenCPLEX(&error);
@@ -19,17 +97,19 @@ void CPLEX_model_new(TSPinst* inst, CPXENVptr* env, CPXLPptr* lp) {
 	char **cname = (char **) calloc(1, sizeof(char *));	
 	cname[0] = (char *) calloc(100, sizeof(char));
 
-	// add binary var.s x(i,j) for i < j  
-	for ( int i = 0; i < inst->nnodes; i++ ){
-		for ( int j = i+1; j < inst->nnodes; j++ ){
+	// add binary var.s x(i,j) for i < j, only for the edges of the candidate graph if any
+	for ( size_t e = 0; e < nedges; e++ ){
+		int i, j;
+		CPLEX_xcoords(inst, e, &i, &j);
 
-			sprintf(cname[0], "x(%d,%d)", i+1,j+1);  
-			double obj = get_arc(inst,i,j);
+		sprintf(cname[0], "x(%d,%d)", i+1,j+1);  
+		double obj = get_arc(inst,i,j);
 
-			if ( CPXnewcols(*env, *lp, 1, &obj, &lb, &ub, &binary, cname) ) print_state(Error, "wrong CPXnewcols on x var.s");
-        	if ( CPXgetnumcols(*env,*lp)-1 != coords_to_index(inst->nnodes,i,j) ) print_state(Error, "wrong position for x var.s");
-		}
-	} 
+		if ( CPXnewcols(*env, *lp, 1, &obj, &lb, &ub, &binary, cname) ) print_state(Error, "wrong CPXnewcols on x var.s");
+		if ( CPXgetnumcols(*env,*lp)-1 != CPLEX_xpos(inst,i,j) ) print_state(Error, "wrong position for x var.s");
+	}
+	// edges outside the graph get their column on demand (CPLEX_xpos_new)
+	if ( inst->graph != NULL ) inst->graph->nextra = 0;
 
 	int *index = (int *) malloc(inst->nnodes * sizeof(int));
 	double *value = (double *) malloc(inst->nnodes * sizeof(double));  
@@ -40,11 +120,20 @@ void CPLEX_model_new(TSPinst* inst, CPXENVptr* env, CPXLPptr* lp) {
 		char sense = 'E';                     // 'E' for equality constraint 
 		sprintf(cname[0], "degree(%d)", h+1); 
 		int nnz = 0;
-		for ( int i = 0; i < inst->nnodes; i++ ){
-			if ( i == h ) continue;
-			index[nnz] = coords_to_index(inst->nnodes,h, i);
-			value[nnz] = 1.0;
-			nnz++;
+		if ( inst->graph != NULL ) {
+			for ( size_t a = inst->graph->start[h]; a < inst->graph->start[h+1]; a++ ){
+				index[nnz] = CPLEX_xpos(inst, h, inst->graph->adj[a]);
+				value[nnz] = 1.0;
+				nnz++;
+			}
+		}
+		else {
+			for ( int i = 0; i < inst->nnodes; i++ ){
+				if ( i == h ) continue;
+				index[nnz] = coords_to_index(inst->nnodes,h, i);
+				value[nnz] = 1.0;
+				nnz++;
+			}
 		}
 		
 		if (CPXaddrows(*env, *lp, 0, 1, nnz, &rhs, &sense, &izero, index, value, NULL, &cname[0]) ) print_state(Error, " wrong CPXaddrows [degree]");
@@ -57,6 +146,70 @@ void CPLEX_model_new(TSPinst* inst, CPXENVptr* env, CPXLPptr* lp) {
 }
 
 
+/// @brief number of x var.s in the CPLEX model of an instance
+/// @param inst TSPinst instance pointer
+/// @return number of columns
+int CPLEX_ncols(const TSPinst* inst) {
+	if(inst->graph == NULL) return EDGE_COUNT(inst->nnodes);
+	return inst->graph->nedges + inst->graph->nextra;
+}
+
+
+/// @brief column of the var. x(i,j) in the CPLEX model
+/// @param inst TSPinst instance pointer
+/// @param i node of index i
+/// @param j node of index j
+/// @return index of the column, -1 if the edge has no column
+int CPLEX_xpos(const TSPinst* inst, const int i, const int j) {
+	if(inst->graph == NULL) return coords_to_index(inst->nnodes, i, j);
+
+	const TSPgraph* graph = inst->graph;
+	size_t e = graph_edge_index(graph, i, j);
+	if(e < graph->nedges) return e;
+
+	const uint64_t key = (i < j) ? ((uint64_t) i << 32) | j : ((uint64_t) j << 32) | i;
+	for(size_t c = 0; c < graph->nextra; c++)
+		if(graph->extra[c] == key) return graph->nedges + c;
+	return -1;
+}
+
+
+/// @brief column of the var. x(i,j), added to the model if the edge lies outside the candidate graph
+/// @param env CPLEX environment
+/// @param lp CPLEX model
+/// @param inst TSPinst instance pointer
+/// @param i node of index i
+/// @param j node of index j
+/// @return index of the column
+int CPLEX_xpos_new(CPXENVptr env, CPXLPptr lp, TSPinst* inst, const int i, const int j) {
+	int xpos = CPLEX_xpos(inst, i, j);
+	if(xpos >= 0) return xpos;
+
+	TSPgraph* graph = inst->graph;
+	if(graph->nextra == graph->extra_cap) {
+		graph->extra_cap = (graph->extra_cap) ? 2 * graph->extra_cap : 64;
+		graph->extra = (uint64_t*) realloc(graph->extra, graph->extra_cap * sizeof(uint64_t));
+		if(graph->extra == NULL) print_state(Error, " failed to allocate memory for the x var.s!");
+	}
+	graph->extra[graph->nextra++] = (i < j) ? ((uint64_t) i << 32) | j : ((uint64_t) j << 32) | i;
+
+	char binary = 'B';
+	double lb = 0.0, ub = 1.0;
+	double obj = get_arc(inst, i, j);
+	char name[100];
+	char* cname = name;
+	sprintf(name, "x(%d,%d)", ((i < j) ? i : j)+1, ((i < j) ? j : i)+1);
+
+	if ( CPXnewcols(env, lp, 1, &obj, &lb, &ub, &binary, &cname) ) print_state(Error, "wrong CPXnewcols on x var.s");
+	xpos = CPXgetnumcols(env, lp)-1;
+	if ( xpos != CPLEX_ncols(inst)-1 ) print_state(Error, "wrong position for x var.s");
+
+	// rows 0..n-1 are the degree constraints: the new edge enters the ones of its ends
+	if ( CPXchgcoef(env, lp, i, xpos, 1.0) || CPXchgcoef(env, lp, j, xpos, 1.0) ) print_state(Error, "wrong CPXchgcoef [degree]");
+	return xpos;
+}
+
+
 /// @brief Delete a CPLEX problem (env,lp) 
 /// @param env CPLEX environment pointer
 /// @param lp CPLEX model pointer
@@ -79,46 +232,55 @@ void CPLEX_log(CPXENVptr* env,const TSPenv* tsp_env){
 
 
 /// @brief Convert the solution saved on inst->solution to CPX format
+/// @param env CPLEX environment pointer
+/// @param lp CPLEX model pointer
 /// @param inst TSPinst pointer
+/// @param solution hamiltonian circuit
 /// @param index array of indeces
 /// @param value array of non-zeros
-static inline void CPLEX_sol_from_inst(const unsigned int nnodes, const int* solution,int* index, double* value) {
+static inline void CPLEX_sol_from_inst(CPXENVptr env, CPXLPptr lp, TSPinst* inst, const int* solution, int* index, double* value) {
+		const unsigned int nnodes = inst->nnodes;
 		for(int i = 0; i < nnodes-1; i++){
-			index[i] = coords_to_index(nnodes,solution[i],solution[i+1]);
+			index[i] = CPLEX_xpos_new(env,lp,inst,solution[i],solution[i+1]);
 			value[i] = 1.0;
 		}
-		index[nnodes-1] = coords_to_index(nnodes,solution[nnodes-1],solution[0]);
+		index[nnodes-1] = CPLEX_xpos_new(env,lp,inst,solution[nnodes-1],solution[0]);
 		value[nnodes-1] = 1.0;
 }
 
 
 /// @brief Decompose the solution in the xstar format into n-component format
 /// @param xstar solution in xstar format pointer
-/// @param nnodes numbers of nodes
+/// @param inst TSPinst pointer
 /// @param succ array of successor necessary to store the solution
 /// @param comp array that associate a number from 1 to n-component for each node
 /// @param ncomp number of component pointer
-void decompose_solution(const double *xstar, const unsigned int nnodes, int *succ, int *comp, int *ncomp, int* compstarts){   
+void decompose_solution(const double *xstar, const TSPinst* inst, int *succ, int *comp, int *ncomp, int* compstarts){   
+	const unsigned int nnodes = inst->nnodes;
+	const int ncols = CPLEX_ncols(inst);
+
+	// the (at most two) selected edges of every node, column by column
+	int *adj = (int *) malloc(2 * nnodes * sizeof(int));
+	char *degree = (char *) calloc(nnodes, sizeof(char));
+	for ( int k = 0; k < ncols; k++ ) {
+		#if VERBOSE > 2
+			if ( fabs(xstar[k]) > EPSILON && fabs(xstar[k]-1.0) > EPSILON ) print_state(Error, " wrong xstar in decompose_sol()");
+		#endif
+		if ( xstar[k] <= 0.5 ) continue;
+
+		int i, j;
+		CPLEX_xcoords(inst, k, &i, &j);
+		#if VERBOSE > 2
+			if ( degree[i] == 2 || degree[j] == 2 ) print_state(Error, "wrong degree in decompose_sol()");
+		#endif
+		if ( degree[i] < 2 ) adj[2*i + degree[i]++] = j;
+		if ( degree[j] < 2 ) adj[2*j + degree[j]++] = i;
+	}
 	#if VERBOSE > 2
-		int *degree = (int *) calloc(nnodes, sizeof(int));
-		for ( int i = 0; i < nnodes; i++ )
-		{
-			for ( int j = i+1; j < nnodes; j++ )
-			{
-				int k = coords_to_index(nnodes, i,j);
-				if ( fabs(xstar[k]) > EPSILON && fabs(xstar[k]-1.0) > EPSILON ) print_state(Error, " wrong xstar in decompose_sol()");
-				if ( xstar[k] > 0.5 ) 
-				{
-					++degree[i];
-					++degree[j];
-				}
-			}
-		}
 		for ( int i = 0; i < nnodes; i++ )
 		{
 			if ( degree[i] != 2 ) print_state(Error, "wrong degree in decompose_sol()");
 		}	
-		free(degree);
 	#endif
 
     int nstart = 0;
@@ -140,35 +302,41 @@ void decompose_solution(const double *xstar, const unsigned int nnodes, int *suc
 		while ( !done ){
 			comp[i] = *ncomp;
 			done = 1;
-			for ( int j = 0; j < nnodes; j++ ){
-				if ( i != j && xstar[coords_to_index(nnodes,i,j)] > 0.5 && comp[j] == -1 ) {// the edge [i,j] is selected in xstar and j was not visited before
-					succ[i] = j;
-					i = j;
-					done = 0;
-					break;
-				}
+			// the selected edge [i,j] to the smallest j not visited before
+			int next = -1;
+			for ( int d = 0; d < degree[i]; d++ ){
+				int j = adj[2*i + d];
+				if ( comp[j] == -1 && (next == -1 || j < next) ) next = j;
+			}
+			if ( next >= 0 ) {
+				succ[i] = next;
+				i = next;
+				done = 0;
 			}
 		}	
 		succ[i] = start;
 	}
+
+	free(degree);
+	free(adj);
 }
 
 
 /// @brief Post an heuristic solution inside CPLEX model
-/// @param succ TSPinst solution
-/// @param nnodes number of nodes
 /// @param env CPLEX environment pointer
 /// @param lp CPLEX model pointer
-void CPLEX_mip_st(CPXENVptr env, CPXLPptr lp, int* succ, const unsigned int nnodes) {
+/// @param inst TSPinst pointer
+/// @param tour hamiltonian circuit (edges outside the candidate graph get their column)
+void CPLEX_mip_st(CPXENVptr env, CPXLPptr lp, TSPinst* inst, const int* tour) {
 
 	int start_index = 0;
 	int effort_level = CPX_MIPSTART_NOCHECK;
-	int* index = (int*) calloc(nnodes,sizeof(int));
-	double* value = (double*) calloc(nnodes,sizeof(double));
+	int* index = (int*) calloc(inst->nnodes,sizeof(int));
+	double* value = (double*) calloc(inst->nnodes,sizeof(double));
 
-	CPLEX_sol_from_inst(nnodes,succ,index,value);
+	CPLEX_sol_from_inst(env,lp,inst,tour,index,value);
 
-	if (CPXaddmipstarts(env, lp, 1, nnodes, &start_index, index, value, &effort_level, NULL)) print_state(Error, "CPXaddmipstarts() error");	
+	if (CPXaddmipstarts(env, lp, 1, inst->nnodes, &start_index, index, value, &effort_level, NULL)) print_state(Error, "CPXaddmipstarts() error");	
 	
 	free(index);
 	free(value);
@@ -211,33 +379,24 @@ static inline void add_SEC_cut(int k,int* nz, double* rh, int* index, double* va
 /// @brief Add SECs as new constraints in the CPLEX model
 /// @param env CPLEX environment pointer
 /// @param lp CPLEX model pointer
-/// @param nnodes number of nodes
+/// @param inst TSPinst pointer
 /// @param ncomp number of component
 /// @param comp array that associate a number from 1 to n-component for each node
-void add_SEC_mdl(CPXCENVptr env, CPXLPptr lp,const int* comp, const unsigned int ncomp, const unsigned int nnodes, int* succ, int* nstarts){
+void add_SEC_mdl(CPXCENVptr env, CPXLPptr lp,const int* comp, const unsigned int ncomp, const TSPinst* inst, int* succ, int* nstarts){
 
 	if(ncomp==1) print_state(Error, "no sec needed for 1 comp!");
 
-	int* index = (int*) calloc((nnodes*(nnodes-1))/2,sizeof(int));
-	double* value = (double*) calloc((nnodes*(nnodes-1))/2,sizeof(double));
+	int* index = (int*) calloc(CPLEX_ncols(inst),sizeof(int));
+	double* value = (double*) calloc(CPLEX_ncols(inst),sizeof(double));
 	char sense ='L';
 	int start_index = 0;
 	
 
-	int* out = calloc(nnodes, sizeof(int));
+	int* out = calloc(inst->nnodes, sizeof(int));
 	for(int k=1;k<=ncomp;k++) {
-		int nnz=0;
-		double rhs=-1.0;
 		int ssize = get_subset_array(out, succ, nstarts[k-1]);
-
-        for(int i = 0; i < ssize; i++) {
-			rhs++;
-			for(int j = i+1; j < ssize; j++) {
-				index[nnz]=coords_to_index(nnodes,out[i],out[j]);
-				value[nnz]=1.0;
-				nnz++;
-			}
-		}
+		double rhs = ssize - 1.0;
+		int nnz = SEC_row(inst, out, ssize, index, value);
 	
 		//add_SEC_cut(k, &nnz, &rhs, index, value, comp, nnodes);
 		if( CPXaddrows(env,lp,0,1,nnz,&rhs,&sense,&start_index,index,value,NULL,NULL)) print_state(Error, "CPXaddrows() error");
@@ -249,7 +408,7 @@ void add_SEC_mdl(CPXCENVptr env, CPXLPptr lp,const int* comp, const unsigned int
 
 int add_SEC_int(CPXCALLBACKCONTEXTptr context,TSPinst inst){
 	  	
-	int ncols = inst.nnodes*(inst.nnodes-1)/2;
+	int ncols = CPLEX_ncols(&inst);
 	double* xstar = (double*) malloc(ncols * sizeof(double));  
 	double objval = CPX_INFBOUND; 
 
@@ -260,7 +419,7 @@ int add_SEC_int(CPXCALLBACKCONTEXTptr context,TSPinst inst){
     int *nstart = calloc(inst.nnodes/2, sizeof(int)); 
 	int ncomp;
 
-	decompose_solution(xstar,inst.nnodes,succ,comp,&ncomp, nstart);
+	decompose_solution(xstar,&inst,succ,comp,&ncomp, nstart);
 	free(xstar);
 
 	if (ncomp == 1) {
@@ -293,20 +452,11 @@ int add_SEC_int(CPXCALLBACKCONTEXTptr context,TSPinst inst){
 
 	int* out = calloc(inst.nnodes, sizeof(int));
 	for(int k=1;k<=ncomp;k++) {
-		int nnz=0;
-		double rhs = -1.0;
 		//add_SEC_cut(k, &nnz, &rhs, index, value, comp, inst.nnodes); 
 
 		int ssize = get_subset_array(out, succ, nstart[k-1]);
-
-		for(int i = 0; i < ssize; i++) {
-			rhs++;
-			for(int j = i+1; j < ssize; j++) {
-				index[nnz]=coords_to_index(inst.nnodes,out[i],out[j]);
-				value[nnz]=1.0;
-				nnz++;
-			}
-		}
+		double rhs = ssize - 1.0;
+		int nnz = SEC_row(&inst, out, ssize, index, value);
 	
 		if (CPXcallbackrejectcandidate(context, 1, nnz, &rhs, &sense, &start_index, index, value) ) print_state(Error, "CPXcallbackrejectcandidate() error"); 
 	
@@ -320,13 +470,17 @@ int add_SEC_int(CPXCALLBACKCONTEXTptr context,TSPinst inst){
 	int *ind = (int *) calloc(ncols, sizeof(int));
 	for (int i = 0; i < ncols; i++) { ind[i] = i; val[i] = 0; }
 
+	// columns cannot be added from a callback: a patched tour leaving the model is not posted
+	char post = 1;
+	double cost = 0.0;
     for (int i = 0; i < inst.nnodes; i++) {
-        int xpos = coords_to_index(inst.nnodes, succ[i], succ[i+1]);
-        ind[xpos] = xpos;
+        int xpos = CPLEX_xpos(&inst, i, succ[i]);
+        if (xpos < 0) { post = 0; break; }
         val[xpos] = 1.0;
+        cost += get_arc(&inst, i, succ[i]);
     }
 	
-	if(CPXcallbackpostheursoln(context, ncols, ind, val, compute_cost(&inst, succ), CPXCALLBACKSOLUTION_NOCHECK)) print_state(Error, "CPXcallbackpostheursoln() error");
+	if(post && CPXcallbackpostheursoln(context, ncols, ind, val, cost, CPXCALLBACKSOLUTION_NOCHECK)) print_state(Error, "CPXcallbackpostheursoln() error");
 	free(val);
 	free(ind);
 	
@@ -340,24 +494,15 @@ int add_cut_CPLEX(double cut_value, int cut_nnodes, int* cut_index_nodes, void*
 	
 	cut_par cut_pars = *(cut_par*) userhandle;
 
-	int* index = calloc(cut_nnodes*(cut_nnodes-1)/2,sizeof(int));
-	double* value = calloc(cut_nnodes*(cut_nnodes-1)/2,sizeof(double));
+	int* index = calloc(EDGE_COUNT(cut_nnodes),sizeof(int));
+	double* value = calloc(EDGE_COUNT(cut_nnodes),sizeof(double));
 
 	int izero = 0;
 	int purgeable = CPX_USECUT_FILTER;
 	int local = 0;
-	double rhs = -1.0;
+	double rhs = cut_nnodes - 1.0;
 	char sense = 'L';
-	int nnz = 0;
-
-	for(int i = 0; i<cut_nnodes;i++){
-		rhs++;
-		for(int j =i+1;j < cut_nnodes; j++){
-			index[nnz]=coords_to_index(cut_pars.nnodes,cut_index_nodes[i],cut_index_nodes[j]);
-			value[nnz]=1.0;
-			nnz++;
-		}
-	}	
+	int nnz = SEC_row(cut_pars.inst, cut_index_nodes, cut_nnodes, index, value);
 	
 	if(CPXcallbackaddusercuts(cut_pars.context, 1, nnz, &rhs, &sense, &izero, index, value, &purgeable, &local)) print_state(Error, "CPXcallbackaddusercuts() error");
 
@@ -373,7 +518,7 @@ int add_SEC_flt(CPXCALLBACKCONTEXTptr context,TSPinst inst){
 	CPXcallbackgetinfoint(context,CPXCALLBACKINFO_NODEUID,&nodeid);
 	if(nodeid%10) return 0;
 
-	int ncols = inst.nnodes*(inst.nnodes-1)/2;
+	int ncols = CPLEX_ncols(&inst);
 	double* xstar = (double*) malloc(ncols * sizeof(double));
     double* xstar2 = (double*) calloc(ncols, sizeof(double));  
 	double objval = CPX_INFBOUND; 
@@ -388,26 +533,22 @@ int add_SEC_flt(CPXCALLBACKCONTEXTptr context,TSPinst inst){
 
     int k=0;
     int n = 0;
-	for(int i = 0; i<inst.nnodes; i++){
-		for(int j=i+1;j<inst.nnodes;j++){
-            int f = coords_to_index(inst.nnodes, i, j);
-            if(xstar[f] <= EPSILON) continue; 
-			elist[k]=i;
-			elist[++k]=j;
-			k++;
-            xstar2[n++]  = xstar[f];
-		}
+	for(int f = 0; f < ncols; f++){
+		if(xstar[f] <= EPSILON) continue; 
+		CPLEX_xcoords(&inst, f, &elist[k], &elist[k+1]);
+		k += 2;
+		xstar2[n++]  = xstar[f];
 	}
 
 	CCcut_connect_components(inst.nnodes,n,elist,xstar2,&ncomp,&compscount,&comps);
 
-	cut_par user_handle= {context,inst.nnodes};
+	cut_par user_handle= {context,&inst};
 	if(ncomp ==1) {
 		#if VERBOSE > 1
 			printf("\e[1mBRANCH & CUT\e[m \t%4d \e[3mFLOW cut\e[m found\n",ncomp);
 		#endif
 
-		CCcut_violated_cuts(inst.nnodes,ncols,elist,xstar2,1.9,add_cut_CPLEX,(void*) &user_handle);
+		CCcut_violated_cuts(inst.nnodes,n,elist,xstar2,1.9,add_cut_CPLEX,(void*) &user_handle);
 	}
 	else {
 		#if VERBOSE > 1
@@ -455,15 +596,82 @@ int CPXPUBLIC mount_CUT(CPXCALLBACKCONTEXTptr context, CPXLONG contextid, void*
 extern void add_warm_start(CPXENVptr CPX_env, CPXLPptr CPX_lp, TSPinst* inst, TSPenv* env) {
 	double tot_tl = env->time_limit;
 	env->time_limit = tot_tl/100;
-	TSPsol tmp = TSPgreedy(inst,env,((double)rand())/RAND_MAX*inst->nnodes, TSPg2optb, NULL , get_time());
+	TSPsol tmp = TSPstart(inst,env,((double)rand())/RAND_MAX*inst->nnodes, local_search_func(env), NULL , get_time());
 	
-	CPLEX_mip_st(CPX_env, CPX_lp, tmp.tour,inst->nnodes);
+	CPLEX_mip_st(CPX_env, CPX_lp, inst, tmp.tour);
 	env->time_limit = tot_tl - (tot_tl/100);
 	#if VERBOSE > 0
 		print_state(Info, "passing an heuristic solution to CPLEX...\n");
 	#endif
 }
 
+#pragma region kernel_instances
+
+/// @brief best patching move between two components, inlined on one distance kernel
+/// @return 1 if min_cross has been improved, 0 otherwise
+DIST_INLINE char patch_scan(const TSPinst* inst, const int* succ, const int start1, const int start2, cross* min_cross, const arc_fun arc) {
+	const TSPdist* dist = inst->dist;
+	char found = 0;
+
+	for(int i = start1; succ[i] != start1; i = succ[i]) {
+		const int in = succ[i];
+		const double c_i = arc(dist, i, in);
+
+		for(int j = start2; succ[j] != start2; j = succ[j]) {
+			double del_cost = (arc(dist, j, i) + arc(dist, succ[j], in)) - (arc(dist, j, succ[j]) + c_i);
+			if(del_cost < min_cross->delta_cost) {
+				*min_cross = (cross) {.i = i, .j = j, .delta_cost = del_cost};
+				found = 1;
+			}
+		}
+	}
+	return found;
+}
+
+typedef char (*patch_fun)(const TSPinst*, const int*, const int, const int, cross*);
+
+#define PATCH_INSTANCE(name)	static char patch_##name(const TSPinst* inst, const int* succ, const int start1, const int start2, cross* min_cross) { return patch_scan(inst, succ, start1, start2, min_cross, arc_##name); }
+#define PATCH_PTR(name)			patch_##name,
+DIST_KERNELS(PATCH_INSTANCE)
+static const patch_fun patch_kernels[] = { DIST_KERNELS(PATCH_PTR) };
+
+#pragma endregion
+
+
+/// @brief best patching move between a component and the others, restricted to the candidate graph
+/// @param inst instance of TSPinst (with candidate graph)
+/// @param succ solution in cplex format
+/// @param comp array that associate edge with route number
+/// @param nstart first node of every remaining component
+/// @param k1 component to merge
+/// @param group_size number of remaining components
+/// @param best_set component that k1 will be merged with
+/// @return best cross found (delta_cost = DBL_MAX if no candidate edge leaves k1)
+static cross patching_graph_cross(const TSPinst* inst, const int* succ, const int* comp, const int* nstart, const int k1, const int group_size, int* best_set) {
+	const TSPgraph* graph = inst->graph;
+	cross min_cross = { .delta_cost = DBL_MAX, .i = -1, .j = -1 };
+
+	int i = nstart[k1];
+	do {
+		for(size_t a = graph->start[i]; a < graph->start[i+1]; a++) {
+			int j = graph->adj[a];
+			if(comp[j] == comp[i]) continue;
+
+			double del_cost = delta_cost(inst, j, succ[j], i, succ[i]);
+			if(del_cost < min_cross.delta_cost) min_cross = (cross) {.i = i, .j = j, .delta_cost = del_cost};
+		}
+		i = succ[i];
+	} while(i != nstart[k1]);
+
+	if(min_cross.delta_cost == DBL_MAX) return min_cross;
+
+	for(int k2 = 0; k2 < group_size; k2++) {
+		if(comp[nstart[k2]] == comp[min_cross.j]) { *best_set = k2; break; }
+	}
+	return min_cross;
+}
+
+
 /// @brief patching for a non final bender's loop solution 
 /// @param inst instance of TSPinst
 /// @param succ solution in cplex format
@@ -478,20 +686,14 @@ void patching(TSPinst* inst, int* succ, int* comp, const unsigned int comp_size,
 		for(int k1 = 0; k1 < group_size-1; k1++) {
 			cross min_cross = { .delta_cost = DBL_MAX, .i = -1, .j = -1 };
 
-			for(int k2 = 0; k2 < group_size; k2++) {
-				if(k2 == k1) continue;
+			// candidate graph first, full scan only if no candidate edge leaves the component
+			if(inst->graph != NULL) min_cross = patching_graph_cross(inst, succ, comp, nstart, k1, group_size, &best_set);
+			char full_scan = (min_cross.delta_cost == DBL_MAX);
 
-				for(int i = nstart[k1]; succ[i] != nstart[k1]; i = succ[i]) {
+			for(int k2 = 0; k2 < group_size && full_scan; k2++) {
+				if(k2 == k1) continue;
 
-					for(int j = nstart[k2]; succ[j] != nstart[k2]; j = succ[j]) {
-						double del_cost = delta_cost(inst, j, succ[j], i, succ[i]);
-						if(del_cost < min_cross.delta_cost) {
-							min_cross = (cross) {.i = i, .j = j, .delta_cost = del_cost};
-							best_set = k2;
-						}
-						
-					} 
-				}
+				if(patch_kernels[inst->dist->kernel](inst, succ, nstart[k1], nstart[k2], &min_cross)) best_set = k2;
 			}
 
 			#if VERBOSE > 2
@@ -506,9 +708,11 @@ void patching(TSPinst* inst, int* succ, int* comp, const unsigned int comp_size,
 			succ[min_cross.i] = succ[min_cross.j];
 			succ[min_cross.j] = dummy;
 
-			for(int z = nstart[best_set]; succ[z] != nstart[best_set]; z = succ[z]) {
+			int z = nstart[best_set];
+			do {
 				comp[z] = comp[nstart[k1]];
-			}
+				z = succ[z];
+			} while(z != nstart[best_set]);
 			nstart[best_set] = nstart[--group_size];
 
 			#if VERBOSE > 2
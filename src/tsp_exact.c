@@ -98,15 +98,15 @@ TSPsol TSPCbranchcut(TSPinst* inst, TSPenv* tsp_env, CPXENVptr* env, CPXLPptr* l
 	if (CPXcallbacksetfunc(*env, *lp, contextid, mount_CUT, inst)) print_state(Error, "CPXcallbacksetfunc() error"); 
 
 	double lb = inst->cost;
-	int succ[inst->nnodes];
-	int comp[inst->nnodes];
-	int nstart[inst->nnodes];
+	int* succ = (int*) malloc(inst->nnodes * sizeof(int));
+	int* comp = (int*) malloc(inst->nnodes * sizeof(int));
+	int* nstart = (int*) malloc(inst->nnodes * sizeof(int));
 	int ncomp;
 
-	double* x_star = (double*) calloc((inst->nnodes*(inst->nnodes-1))/2, sizeof(double));
+	double* x_star = (double*) calloc(CPLEX_ncols(inst), sizeof(double));
 	CPLEX_solve(env,lp,tl,&lb,x_star);
 			
-	decompose_solution(x_star,inst->nnodes,succ,comp,&ncomp, nstart);
+	decompose_solution(x_star,inst,succ,comp,&ncomp, nstart);
 	free(x_star);
 
 	if(ncomp != 1){
@@ -122,6 +122,10 @@ TSPsol TSPCbranchcut(TSPinst* inst, TSPenv* tsp_env, CPXENVptr* env, CPXLPptr* l
 	check_tour_cost(inst, sol, compute_cost(inst, sol));
 	memcpy(out.tour, sol, inst->nnodes * sizeof(int));
 	out.cost = compute_cost(inst, out.tour);
+	free(sol);
+	free(succ);
+	free(comp);
+	free(nstart);
 	return out;
 }
 
@@ -135,9 +139,9 @@ TSPsol TSPCbenders(TSPinst* inst, TSPenv* tsp_env, CPXENVptr* env, CPXLPptr* lp,
 
 	TSPsol out = { .cost = inst->cost, .tour = malloc(inst->nnodes * sizeof(int)) };
 	double lb = inst->cost;
-	int succ[inst->nnodes];
-	int comp[inst->nnodes];
-	int nstart[inst->nnodes];
+	int* succ = (int*) malloc(inst->nnodes * sizeof(int));
+	int* comp = (int*) malloc(inst->nnodes * sizeof(int));
+	int* nstart = (int*) malloc(inst->nnodes * sizeof(int));
 	int ncomp;
 	int iter=0;
 
@@ -146,14 +150,14 @@ TSPsol TSPCbenders(TSPinst* inst, TSPenv* tsp_env, CPXENVptr* env, CPXLPptr* lp,
 	while(REMAIN_TIME(start_time, tsp_env)) {
 		iter++;
 
-		double* x_star = (double*) calloc((inst->nnodes*(inst->nnodes-1))/2, sizeof(double));
+		double* x_star = (double*) calloc(CPLEX_ncols(inst), sizeof(double));
 		CPLEX_solve(env,lp,tsp_env->time_limit-time_elapsed(start_time),&lb,x_star);
 
 		#if VERBOSE > 0
 			print_state(Info, "Lower-Bound \e[1mBENDERS' LOOP\e[m itereation [%i]: \t%10.4f\n", iter, lb);
 		#endif
 
-		decompose_solution(x_star, inst->nnodes, succ, comp, &ncomp, nstart);
+		decompose_solution(x_star, inst, succ, comp, &ncomp, nstart);
 		free(x_star);
 
 		//Iter = 0 --> BENDERS reaches the end
@@ -163,18 +167,21 @@ TSPsol TSPCbenders(TSPinst* inst, TSPenv* tsp_env, CPXENVptr* env, CPXLPptr* lp,
 		}
 
 		//We always apply patching on Benders, in order to have solution if we exceed tl
-		add_SEC_mdl(*env,*lp,comp,ncomp,inst->nnodes, succ, nstart);
+		add_SEC_mdl(*env,*lp,comp,ncomp,inst, succ, nstart);
 		patching(inst,succ,comp,ncomp, nstart);
 		int* sol  = calloc (inst->nnodes,sizeof(int));
 		cth_convert(sol, succ, inst->nnodes);
 		//if(tsp_env->warm) 
-		CPLEX_mip_st(*env,*lp,sol,inst->nnodes);
+		CPLEX_mip_st(*env,*lp,inst,sol);
 		free(sol);
 	}
 
 	
 	if(iter) strcpy(tsp_env->method,"BENDERS-PATCHING");
 	out.cost = compute_cost(inst,cth_convert(out.tour, succ, inst->nnodes));
+	free(succ);
+	free(comp);
+	free(nstart);
 	return out;
 }
 
@@ -0,0 +1,176 @@
+#include "../include/tsp_gen.h"
+
+#pragma region static_functions
+
+/// @brief splitmix64 finalizer: a bijective 64-bit mixer
+static inline uint64_t gen_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+
+/// @brief counter-based random number: the draw depends only on (key, counter), never on
+///        the thread (or the order) that asks for it
+/// @param key stream key
+/// @param counter position inside the stream
+/// @return uniform double in [0,1)
+static inline double gen_uniform(const uint64_t key, const uint64_t counter) {
+    return (gen_mix(key + (counter + 1) * GEN_GOLDEN) >> 11) * 0x1.0p-53;
+}
+
+
+/// @brief clamp a coordinate inside the square and round it to 1/GEN_PRECISION (exact when written as text)
+static inline double gen_coord(const double v) {
+    double c = (v < 0) ? 0 : (v > MAX_DIST) ? MAX_DIST : v;
+    return round(c * GEN_PRECISION) / GEN_PRECISION;
+}
+
+
+/// @brief gaussian offset around a center (Box-Muller on two uniform draws)
+static inline point gen_gauss(const double cx, const double cy, const double sigma, const double u1, const double u2) {
+    double r = sigma * sqrt(-2.0 * log(1.0 - u1));
+    return (point) { .x = cx + r * cos(2.0 * M_PI * u2), .y = cy + r * sin(2.0 * M_PI * u2) };
+}
+
+
+/// @brief draw the shared structure of an instance (blob centers, towns and roads) from its own stream
+/// @param model model to fill
+/// @param nnodes number of nodes
+/// @param seed random seed
+/// @param type Uniform, Clustered or Road
+static void gen_model_new(gen_model* model, const unsigned int nnodes, const unsigned int seed, const int type) {
+    *model = (gen_model) { .type = type, .key = gen_mix(seed) };
+    if(type == Uniform) return;
+
+    const uint64_t setup = gen_mix(model->key + 1);
+    model->ncenters = (nnodes / GEN_CLUSTER_SIZE > 1) ? nnodes / GEN_CLUSTER_SIZE : 1;
+    model->centers = (gen_center*) malloc(model->ncenters * sizeof(gen_center));
+
+    // blobs are wide and overlapping, towns are small and dense
+    double spread = MAX_DIST / sqrt(model->ncenters) / ((type == Clustered) ? 4.0 : 16.0);
+    for(unsigned int c = 0; c < model->ncenters; c++) {
+        model->centers[c] = (gen_center) {  .x = MAX_DIST * gen_uniform(setup, 3 * (uint64_t) c),
+                                            .y = MAX_DIST * gen_uniform(setup, 3 * (uint64_t) c + 1),
+                                            .sigma = spread * (0.5 + gen_uniform(setup, 3 * (uint64_t) c + 2)) };
+    }
+    if(type != Road || model->ncenters < 2) return;
+
+    // every town is linked to its two nearest predecessors: a connected network with some loops
+    model->roads = (gen_road*) malloc(2 * model->ncenters * sizeof(gen_road));
+    for(int t = 1; t < model->ncenters; t++) {
+        int first = -1, second = -1;
+        double d1 = INFINITY, d2 = INFINITY;
+
+        for(int s = 0; s < t; s++) {
+            double dx = model->centers[t].x - model->centers[s].x;
+            double dy = model->centers[t].y - model->centers[s].y;
+            double d = dx * dx + dy * dy;
+
+            if(d < d1)      { second = first; d2 = d1; first = s; d1 = d; }
+            else if(d < d2) { second = s; d2 = d; }
+        }
+        model->roads[model->nroads++] = (gen_road) { .a = t, .b = first };
+        if(second >= 0) model->roads[model->nroads++] = (gen_road) { .a = t, .b = second };
+    }
+}
+
+
+/// @brief coordinates of node i: four draws of the node stream, whatever thread computes it
+/// @param model instance model
+/// @param i node index
+/// @return point of node i
+static point gen_node(const gen_model* model, const unsigned int i) {
+    const uint64_t ctr = 4 * (uint64_t) i;
+    double u0 = gen_uniform(model->key, ctr);
+    double u1 = gen_uniform(model->key, ctr + 1);
+    double u2 = gen_uniform(model->key, ctr + 2);
+    point p;
+
+    switch (model->type) {
+        case Clustered: {
+            const gen_center* c = &model->centers[(unsigned int) (u0 * model->ncenters)];
+            p = gen_gauss(c->x, c->y, c->sigma, u1, u2);
+            break;
+        }
+        case Road: {
+            if(model->nroads == 0 || u0 < GEN_TOWN_SHARE) {
+                const gen_center* c = &model->centers[(unsigned int) (u0 / GEN_TOWN_SHARE * model->ncenters) % model->ncenters];
+                p = gen_gauss(c->x, c->y, c->sigma, u1, u2);
+                break;
+            }
+            const gen_road* r = &model->roads[(unsigned int) ((u0 - GEN_TOWN_SHARE) / (1.0 - GEN_TOWN_SHARE) * model->nroads)];
+            const gen_center* a = &model->centers[r->a];
+            const gen_center* b = &model->centers[r->b];
+            double t = gen_uniform(model->key, ctr + 3);
+            p = gen_gauss(a->x + t * (b->x - a->x), a->y + t * (b->y - a->y), GEN_ROAD_WIDTH, u1, u2);
+            break;
+        }
+        default:
+            p = (point) { .x = MAX_DIST * u0, .y = MAX_DIST * u1 };
+            break;
+    }
+    return (point) { .x = gen_coord(p.x), .y = gen_coord(p.y) };
+}
+
+
+/// @brief worker: claim blocks of GEN_BLOCK nodes until every point is drawn
+/// @param userhandle pointer to mt_gen_pars
+static void* gen_job(void* userhandle) {
+    mt_gen_pars* pars = (mt_gen_pars*) userhandle;
+
+    unsigned int start;
+    while((start = __atomic_fetch_add(&pars->mt_next_node, GEN_BLOCK, __ATOMIC_RELAXED)) < pars->mt_nnodes) {
+        unsigned int end = (start + GEN_BLOCK < pars->mt_nnodes) ? start + GEN_BLOCK : pars->mt_nnodes;
+
+        for(unsigned int i = start; i < end; i++) pars->mt_points[i] = gen_node(pars->mt_model, i);
+    }
+    return NULL;
+}
+
+#pragma endregion
+
+
+/// @brief generate a random instance in [0,MAX_DIST]^2 with counter-based streams: the
+///        points are the same (byte by byte) for every number of threads
+/// @param points destination array (nnodes points)
+/// @param nnodes number of nodes
+/// @param seed random seed
+/// @param type Uniform, Clustered (gaussian blobs) or Road (towns linked by roads)
+void gen_points(point* points, const unsigned int nnodes, const unsigned int seed, const int type) {
+    gen_model model;
+    gen_model_new(&model, nnodes, seed, type);
+
+    int threads = mt_pool_size();
+
+    mt_gen_pars gen_par = { .mt_model = &model,
+                            .mt_points = points,
+                            .mt_nnodes = nnodes,
+                            .mt_next_node = 0 };
+
+    mt_context* gen_ctx = new_mt_context(threads, !HANDLE_MTX);
+    run_job(gen_ctx, gen_job, &gen_par);
+    delete_mt_context(gen_ctx, !HANDLE_MTX);
+
+    free(model.centers);
+    free(model.roads);
+
+    #if VERBOSE > 1
+        print_state(Info, "Random instance generated on %d threads\n", threads);
+    #endif
+}
+
+
+/// @brief parse the generator given by cli
+/// @param name UNIFORM, CLUSTER or ROAD
+/// @return generator type
+int gen_type_parse(const char* name) {
+    char* uni_type[] = {"UNIFORM", "UNI"};
+    char* clu_type[] = {"CLUSTER", "CLUSTERED", "BLOB"};
+    char* road_type[] = {"ROAD", "ROADS"};
+
+    if(strnin(name, uni_type, 2)) return Uniform;
+    if(strnin(name, clu_type, 3)) return Clustered;
+    if(!strnin(name, road_type, 2)) print_state(Error, "Generator %s not implemented!\n", name);
+    return Road;
+}
@@ -0,0 +1,471 @@
+#include "../include/tsp_solver.h"
+
+#pragma region static_functions
+
+/// @brief sort karp_item by key (node index on ties, so that the cells never depend on qsort)
+static int item_ascending(const void* elem1, const void* elem2) {
+    const karp_item* f = (const karp_item*) elem1;
+    const karp_item* s = (const karp_item*) elem2;
+    if(f->key != s->key) return (f->key > s->key) - (f->key < s->key);
+    return f->node - s->node;
+}
+
+
+/// @brief coordinate of a node along one of the two cutting axes of a partition variant
+/// @param variant odd variants cut along the diagonals, so that their boundaries cross the others
+/// @param axis 0 or 1
+static inline double karp_axis(const TSPinst* inst, const int i, const int variant, const int axis) {
+    const double x = inst->xcoord[i];
+    const double y = inst->ycoord[i];
+    if(variant & 1) return (axis) ? x - y : x + y;
+    return (axis) ? y : x;
+}
+
+
+/// @brief split a box of nodes in two along its wider axis until every cell holds about KARP_CELL nodes
+/// @param items nodes of the box in [lo, hi)
+/// @param variant partition variant: bit 0 rotates the axes by 45 degrees, bit 1 moves every cut by half a cell
+/// @param part partition to fill
+static void karp_split(const TSPinst* inst, karp_item* items, const int lo, const int hi, const int variant, karp_partition* part) {
+    const int count = hi - lo;
+    const int k = (count + KARP_CELL / 2) / KARP_CELL;
+
+    if(k <= 1) {
+        for(int i = lo; i < hi; i++) part->cell[items[i].node] = part->ncells;
+        part->ncells++;
+        return;
+    }
+
+    double umin = INFINITY, umax = -INFINITY, vmin = INFINITY, vmax = -INFINITY;
+    for(int i = lo; i < hi; i++) {
+        double u = karp_axis(inst, items[i].node, variant, 0);
+        double v = karp_axis(inst, items[i].node, variant, 1);
+        if(u < umin) umin = u;
+        if(u > umax) umax = u;
+        if(v < vmin) vmin = v;
+        if(v > vmax) vmax = v;
+    }
+    const int axis = (umax - umin < vmax - vmin);
+    for(int i = lo; i < hi; i++) items[i].key = karp_axis(inst, items[i].node, variant, axis);
+    qsort(items + lo, count, sizeof(karp_item), item_ascending);
+
+    const int kl = k / 2;
+    const double share = (variant & 2) ? (kl - 0.5) / k : (double) kl / k;
+    const int mid = lo + (int) (share * count);
+
+    karp_split(inst, items, lo, mid, variant, part);
+    karp_split(inst, items, mid, hi, variant, part);
+}
+
+
+/// @brief 2-opt (the one chosen by -ls) and Or-opt alternated until neither improves, as inside VNS
+static void karp_vnd(const TSPinst* inst, const TSPenv* env, double init_time, int* tour, double* cost) {
+    opt_fun local_search = local_search_func(env);
+
+    double vnd_cost;
+    do {
+        local_search(inst, env, init_time, tour, cost);
+        vnd_cost = *cost;
+        TSPoropt(inst, env, init_time, tour, cost);
+    } while (*cost < vnd_cost - COST_EPS(inst) && REMAIN_TIME(init_time, env));
+}
+
+
+/// @brief true if (a,b) is one of the fixed arcs of a cell, i.e. it stands for a piece of tour outside the cell
+/// @param fixed fixed[l] is 1 if the arc (l, l+1) of the cell is fixed
+/// @param m number of nodes of the cell
+static inline char karp_fixed(const char* fixed, const unsigned int m, const int a, const int b) {
+    return (b == (a + 1) % m && fixed[a]) || (a == (b + 1) % m && fixed[b]);
+}
+
+
+/// @brief build the instance of a cell: its nodes in tour order, distances on the fly, the fixed
+///        arcs that join the end of a sub-path to the start of the next one pinned and the
+///        candidates of the instance that fall in the cell
+/// @param pars shared round data
+/// @param c cell index
+/// @param fixed fixed[l] is 1 if the arc (l, l+1) is fixed
+/// @return an instance of TSPinst over the cell (node l is the l-th node of the cell)
+static TSPinst* karp_instance_new(const mt_karp_pars* pars, const unsigned int c, const char* fixed) {
+    const TSPinst* inst = pars->mt_inst;
+    const int* nodes = pars->mt_cell_nodes + pars->mt_cell_start[c];
+    const unsigned int m = pars->mt_cell_start[c + 1] - pars->mt_cell_start[c];
+
+    TSPinst* sub = instance_new();
+    sub->nnodes = m;
+    sub->edge_type = inst->edge_type;
+    sub->xcoord = (double*) malloc(m * sizeof(double));
+    sub->ycoord = (double*) malloc(m * sizeof(double));
+    for(int l = 0; l < m; l++) { sub->xcoord[l] = inst->xcoord[nodes[l]]; sub->ycoord[l] = inst->ycoord[nodes[l]]; }
+
+    // same metric and rounding as the instance, on the fly
+    TSPenv sub_env = *pars->mt_env;
+    sub_env.mem_limit = 0;
+    sub->dist = dist_new(sub, &sub_env);
+
+    // no local search removes a pinned arc, so every sub-path keeps its ends
+    dist_pin(sub->dist, fixed, m);
+
+    // without a table a cell is always searched through candidates (built with CAND_SIZE ones if -k 0):
+    // a list keeps the candidates inside the cell and is padded with the last of them
+    if(inst->cand == NULL) {
+        sub->kdtree = (PLANAR_METRIC(sub->edge_type)) ? kdtree_new(sub) : NULL;
+        sub->cand_k = (CAND_SIZE < m) ? CAND_SIZE : m - 1;
+        sub->cand = cand_new(sub, sub->cand_k);
+        return sub;
+    }
+
+    sub->cand_k = (inst->cand_k < m) ? inst->cand_k : m - 1;
+    sub->cand = (int*) malloc((size_t) m * sub->cand_k * sizeof(int));
+    for(int l = 0; l < m; l++) {
+        const int* list = inst->cand + (size_t) nodes[l] * inst->cand_k;
+        int* sub_list = sub->cand + (size_t) l * sub->cand_k;
+        unsigned int size = 0;
+
+        for(int h = 0; h < inst->cand_k && size < sub->cand_k; h++)
+            if(pars->mt_cell[list[h]] == c) sub_list[size++] = pars->mt_local[list[h]];
+        for(int h = size; h < sub->cand_k; h++) sub_list[h] = (size) ? sub_list[size - 1] : (l + 1) % m;
+    }
+
+    return sub;
+}
+
+
+/// @brief optimize the sub-paths of a cell and write the new neighbours of its nodes
+/// @param pars shared round data
+/// @param c cell index
+/// @return gain of the cell (0 if it did not improve)
+static double karp_cell(const mt_karp_pars* pars, const unsigned int c) {
+    const TSPinst* inst = pars->mt_inst;
+    const unsigned int n = inst->nnodes;
+    const int* nodes = pars->mt_cell_nodes + pars->mt_cell_start[c];
+    const unsigned int m = pars->mt_cell_start[c + 1] - pars->mt_cell_start[c];
+    if(m < KARP_MIN_CELL) return 0.0;
+
+    // a sub-path ends where the next node of the cell is not the next node of the tour
+    char* fixed = (char*) malloc(m * sizeof(char));
+    unsigned int nfixed = 0;
+    for(int l = 0; l < m; l++) nfixed += (fixed[l] = (pars->mt_tour[(pars->mt_pos[nodes[l]] + 1) % n] != nodes[(l + 1) % m]));
+
+    TSPinst* sub = karp_instance_new(pars, c, fixed);
+    int* sub_tour = (int*) malloc(m * sizeof(int));
+    double sub_cost = 0.0, init_cost = 0.0;
+    for(int l = 0; l < m; l++) {
+        sub_tour[l] = l;
+        sub_cost += get_arc(sub, l, (l + 1) % m);
+        if(!fixed[l]) init_cost += get_arc(inst, nodes[l], nodes[(l + 1) % m]);
+    }
+
+    karp_vnd(sub, pars->mt_env, pars->mt_init_time, sub_tour, &sub_cost);
+
+    // the gain is measured again on the real arcs: the fixed ones would swallow it in round-off
+    double new_cost = 0.0;
+    unsigned int kept = 0;
+    for(int p = 0; p < m; p++) {
+        int a = sub_tour[p], b = sub_tour[(p + 1) % m];
+        if(karp_fixed(fixed, m, a, b)) kept++;
+        else new_cost += get_arc(inst, nodes[a], nodes[b]);
+    }
+
+    double gain = new_cost - init_cost;
+    if(kept == nfixed && gain < -COST_EPS(inst)) {
+        for(int p = 0; p < m; p++) {
+            int l = sub_tour[p];
+            int side[2] = { sub_tour[(p + m - 1) % m], sub_tour[(p + 1) % m] };
+            int g = nodes[l];
+
+            // a fixed arc is the tour leaving the cell: it keeps the neighbour outside the cell
+            for(int s = 0; s < 2; s++) {
+                if(!karp_fixed(fixed, m, l, side[s])) pars->mt_adj[2 * g + s] = nodes[side[s]];
+                else if(side[s] == (l + 1) % m) pars->mt_adj[2 * g + s] = pars->mt_tour[(pars->mt_pos[g] + 1) % n];
+                else pars->mt_adj[2 * g + s] = pars->mt_tour[(pars->mt_pos[g] + n - 1) % n];
+            }
+        }
+
+        // every new sub-path joins two ends of the runs of the cell: 2r is the start of run r, 2r+1 its end
+        for(int p = 0; p < m; p++) {
+            int a = sub_tour[p];
+            if(!karp_fixed(fixed, m, sub_tour[(p + m - 1) % m], a)) continue;
+
+            int q = p;
+            while(!karp_fixed(fixed, m, sub_tour[q], sub_tour[(q + 1) % m])) q = (q + 1) % m;
+            int b = sub_tour[q];
+
+            int va = 2 * pars->mt_run[nodes[a]] + (a != b && fixed[a]);
+            int vb = 2 * pars->mt_run[nodes[b]] + (a == b || fixed[b]);
+            pars->mt_mate[va] = vb;
+            pars->mt_mate[vb] = va;
+        }
+    }
+    else gain = 0.0;
+
+    instance_delete(sub);
+    free(fixed);
+    free(sub_tour);
+    return gain;
+}
+
+
+/// @brief worker: claim cells one at a time until every cell is optimized or time is over
+/// @param userhandle pointer to mt_karp_pars
+static void* karp_job(void* userhandle) {
+    mt_karp_pars* pars = (mt_karp_pars*) userhandle;
+
+    unsigned int c;
+    while(REMAIN_TIME(pars->mt_init_time, pars->mt_env) && (c = __atomic_fetch_add(&pars->mt_next_cell, 1, __ATOMIC_RELAXED)) < pars->mt_ncells)
+        pars->mt_gain[c] = (pars->mt_todo[c]) ? karp_cell(pars, c) : 0.0;
+    return NULL;
+}
+
+
+/// @brief true if the runs, joined inside the cells by the sub-paths (mate) and by the arcs that
+///        leave a run for the next one, form a single circuit
+/// @param mate mate[v] is the other end of the sub-path that ends in v (2r start, 2r+1 end of run r)
+/// @param nruns number of runs
+static char karp_is_tour(const int* mate, const unsigned int nruns) {
+    int v = 0;
+    unsigned int steps = 0;
+
+    do {
+        int u = mate[v];
+        int r = u >> 1;
+        v = (u & 1) ? 2 * ((r + 1) % nruns) : 2 * ((r + nruns - 1) % nruns) + 1;
+        steps++;
+    } while(v != 0 && steps < nruns);
+
+    return v == 0 && steps == nruns;
+}
+
+
+/// @brief exchange the sub-paths of the runs of a cell between the tour and the cell result
+///        (a second call restores both)
+static void karp_swap(const mt_karp_pars* pars, int* mate, const unsigned int c) {
+    const unsigned int n = pars->mt_inst->nnodes;
+
+    for(int k = pars->mt_cell_start[c]; k < pars->mt_cell_start[c + 1]; k++) {
+        int g = pars->mt_cell_nodes[k];
+        int r = pars->mt_run[g];
+        if(r == pars->mt_run[pars->mt_tour[(pars->mt_pos[g] + n - 1) % n]]) continue;
+
+        for(int v = 2 * r; v <= 2 * r + 1; v++) {
+            int tmp = mate[v];
+            mate[v] = pars->mt_mate[v];
+            pars->mt_mate[v] = tmp;
+        }
+    }
+}
+
+
+/// @brief stitch the improved cells back into the tour: each one is valid on its own, but two cells
+///        that reorder the same stretch of tour can split it, so the cells are added from the best
+///        one on and a cell that splits the tour is left out (and marked in mt_todo); the check
+///        only follows the runs, not the nodes
+/// @param pars round data (cells, runs, results and gains)
+/// @param tour hamiltionian circuit, rewritten
+/// @param adj work array (two entries per node)
+/// @param mate work array (two entries per run)
+/// @param pending number of cells left out
+/// @return gain of the cells applied
+static double karp_merge(const mt_karp_pars* pars, int* tour, int* adj, int* mate, unsigned int* pending) {
+    const unsigned int n = pars->mt_inst->nnodes;
+    const double eps = COST_EPS(pars->mt_inst);
+
+    karp_item* order = (karp_item*) malloc(pars->mt_ncells * sizeof(karp_item));
+    unsigned int nimproved = 0;
+    for(int c = 0; c < pars->mt_ncells; c++) {
+        pars->mt_todo[c] = 0;
+        if(pars->mt_gain[c] < -eps) order[nimproved++] = (karp_item) { .key = pars->mt_gain[c], .node = c };
+    }
+    qsort(order, nimproved, sizeof(karp_item), item_ascending);
+
+    for(int r = 0; r < pars->mt_nruns; r++) { mate[2 * r] = 2 * r + 1; mate[2 * r + 1] = 2 * r; }
+
+    // every improved cell at once first: a single check when the cells do not interfere
+    double gain = 0.0;
+    for(int k = 0; k < nimproved; k++) { karp_swap(pars, mate, order[k].node); gain += order[k].key; }
+    *pending = 0;
+
+    if(!karp_is_tour(mate, pars->mt_nruns)) {
+        for(int k = 0; k < nimproved; k++) karp_swap(pars, mate, order[k].node);
+
+        // the first cell always fits, it was optimized on this very tour
+        gain = 0.0;
+        for(int k = 0; k < nimproved; k++) {
+            karp_swap(pars, mate, order[k].node);
+            if(karp_is_tour(mate, pars->mt_nruns)) { gain += order[k].key; continue; }
+
+            karp_swap(pars, mate, order[k].node);
+            pars->mt_todo[order[k].node] = 1;
+            (*pending)++;
+        }
+    }
+
+    // the cells kept rewrite the neighbours of their nodes, then the tour is walked again
+    for(int i = 0; i < n; i++) {
+        adj[2 * tour[i]] = tour[(i + n - 1) % n];
+        adj[2 * tour[i] + 1] = tour[(i + 1) % n];
+    }
+    for(int k = 0; k < nimproved; k++) {
+        int c = order[k].node;
+        if(pars->mt_todo[c]) continue;
+        for(int h = pars->mt_cell_start[c]; h < pars->mt_cell_start[c + 1]; h++) {
+            int g = pars->mt_cell_nodes[h];
+            adj[2 * g] = pars->mt_adj[2 * g];
+            adj[2 * g + 1] = pars->mt_adj[2 * g + 1];
+        }
+    }
+    free(order);
+
+    int prev = tour[0], curr = adj[2 * tour[0] + 1];
+    for(int i = 1; i < n; i++) {
+        tour[i] = curr;
+        int next = (adj[2 * curr] == prev) ? adj[2 * curr + 1] : adj[2 * curr];
+        prev = curr;
+        curr = next;
+    }
+    return gain;
+}
+
+#pragma endregion
+
+
+/// @brief Karp-style partitioned local search: the plane is cut into k-d cells of about KARP_CELL
+///        nodes, the sub-paths of the tour inside every cell are optimized on the thread pool with
+///        their ends fixed (2-opt set by -ls, then Or-opt) and stitched back; the cuts change from
+///        one round to the next so that the boundaries move, until no partition improves, and a
+///        last pass runs on the whole tour
+/// @param inst instance of TSPinst (needs coordinates, otherwise the whole tour is optimized)
+/// @param tour hamiltionian circuit
+/// @param cost cost of path
+void TSPkarp(const TSPinst* inst, const TSPenv* env, double init_time, int* tour, double* cost) {
+    const unsigned int n = inst->nnodes;
+
+    if(inst->xcoord == NULL || inst->edge_type == EXPLICIT || n < 2 * KARP_CELL) {
+        karp_vnd(inst, env, init_time, tour, cost);
+        return;
+    }
+
+    karp_partition part[KARP_VARIANTS];
+    karp_item* items = (karp_item*) malloc(n * sizeof(karp_item));
+    unsigned int max_cells = 0;
+    for(int v = 0; v < KARP_VARIANTS; v++) {
+        part[v] = (karp_partition) { .ncells = 0, .cell = (int*) malloc(n * sizeof(int)) };
+        for(int i = 0; i < n; i++) items[i].node = i;
+        karp_split(inst, items, 0, n, v, &part[v]);
+        part[v].solved = (unsigned int*) calloc(part[v].ncells, sizeof(unsigned int));
+        if(part[v].ncells > max_cells) max_cells = part[v].ncells;
+    }
+    free(items);
+
+    int* pos = (int*) malloc(n * sizeof(int));
+    int* local = (int*) malloc(n * sizeof(int));
+    unsigned int* stamp = (unsigned int*) malloc(n * sizeof(unsigned int));
+    for(int i = 0; i < n; i++) stamp[i] = 1;
+    int* cell_start = (int*) malloc((max_cells + 1) * sizeof(int));
+    int* cell_next = (int*) malloc(max_cells * sizeof(int));
+    int* cell_nodes = (int*) malloc(n * sizeof(int));
+    int* cell_adj = (int*) malloc(2 * n * sizeof(int));
+    int* adj = (int*) malloc(2 * n * sizeof(int));
+    int* run = (int*) malloc(n * sizeof(int));
+    int* cell_mate = (int*) malloc(2 * n * sizeof(int));
+    int* mate = (int*) malloc(2 * n * sizeof(int));
+    double* gain = (double*) malloc(max_cells * sizeof(double));
+    char* todo = (char*) malloc(max_cells * sizeof(char));
+
+    // rounds on a partition until none of its cells is left out, then the next one, until every
+    // variant in a row leaves the tour as is
+    unsigned int idle = 0, variant = 0, pending = 0;
+    double variant_gain = 0.0;
+    for(unsigned int round = 1; idle < KARP_VARIANTS && REMAIN_TIME(init_time, env); round++) {
+        karp_partition* p = &part[variant];
+
+        // nodes of every cell, in tour order
+        memset(cell_start, 0, (p->ncells + 1) * sizeof(int));
+        for(int i = 0; i < n; i++) { pos[tour[i]] = i; cell_start[p->cell[tour[i]] + 1]++; }
+        for(int c = 0; c < p->ncells; c++) { cell_start[c + 1] += cell_start[c]; cell_next[c] = cell_start[c]; gain[c] = 0.0; }
+        for(int i = 0; i < n; i++) {
+            int c = p->cell[tour[i]];
+            local[tour[i]] = cell_next[c] - cell_start[c];
+            cell_nodes[cell_next[c]++] = tour[i];
+        }
+
+        // runs: maximal stretches of the tour inside one cell, numbered from a cell boundary on
+        unsigned int first = 0, nruns = 0;
+        while(p->cell[tour[first]] == p->cell[tour[(first + n - 1) % n]]) first++;
+        for(int k = 0; k < n; k++) {
+            int i = (first + k) % n;
+            if(k > 0 && p->cell[tour[i]] != p->cell[tour[(i + n - 1) % n]]) nruns++;
+            run[tour[i]] = nruns;
+        }
+        nruns++;
+
+        // a cell is optimized again only if it was left out or if one of its nodes moved since its last round
+        if(!pending) {
+            memset(todo, 0, p->ncells * sizeof(char));
+            for(int i = 0; i < n; i++) if(stamp[i] > p->solved[p->cell[i]]) todo[p->cell[i]] = 1;
+        }
+        for(int c = 0; c < p->ncells; c++) if(todo[c]) p->solved[c] = round;
+
+        mt_karp_pars karp_par = {   .mt_inst = inst,
+                                    .mt_env = env,
+                                    .mt_init_time = init_time,
+                                    .mt_tour = tour,
+                                    .mt_pos = pos,
+                                    .mt_cell_start = cell_start,
+                                    .mt_cell_nodes = cell_nodes,
+                                    .mt_cell = p->cell,
+                                    .mt_local = local,
+                                    .mt_run = run,
+                                    .mt_nruns = nruns,
+                                    .mt_adj = cell_adj,
+                                    .mt_mate = cell_mate,
+                                    .mt_gain = gain,
+                                    .mt_todo = todo,
+                                    .mt_ncells = p->ncells,
+                                    .mt_next_cell = 0 };
+
+        int tasks = (mt_pool_size() < p->ncells) ? mt_pool_size() : p->ncells;
+        mt_context* karp_ctx = new_mt_context(tasks, !HANDLE_MTX);
+        run_job(karp_ctx, karp_job, &karp_par);
+        delete_mt_context(karp_ctx, !HANDLE_MTX);
+
+        double round_gain = karp_merge(&karp_par, tour, adj, mate, &pending);
+        *cost += round_gain;
+        variant_gain += round_gain;
+
+        for(int c = 0; c < p->ncells; c++)
+            if(gain[c] < -COST_EPS(inst) && !todo[c])
+                for(int k = cell_start[c]; k < cell_start[c + 1]; k++) stamp[cell_nodes[k]] = round;
+
+        #if VERBOSE > 1
+            print_state(Info, "Karp partition %u: %u cells, gain %.4f, %u cells left out\n", variant, p->ncells, round_gain, pending);
+        #endif
+        #if VERBOSE > 2
+            check_tour_cost(inst, tour, *cost);
+        #endif
+
+        if(pending) continue;
+        idle = (variant_gain < -COST_EPS(inst)) ? 0 : idle + 1;
+        variant = (variant + 1) % KARP_VARIANTS;
+        variant_gain = 0.0;
+    }
+
+    // an arc that crosses a boundary in every partition (a long one) is only removed by a pass over
+    // the whole tour, which starts from cells that are all local optima
+    karp_vnd(inst, env, init_time, tour, cost);
+
+    for(int v = 0; v < KARP_VARIANTS; v++) { free(part[v].cell); free(part[v].solved); }
+    free(pos);
+    free(local);
+    free(stamp);
+    free(cell_start);
+    free(cell_next);
+    free(cell_nodes);
+    free(cell_adj);
+    free(adj);
+    free(run);
+    free(cell_mate);
+    free(mate);
+    free(gain);
+    free(todo);
+}
@@ -0,0 +1,158 @@
+#include "../include/tsp_solver.h"
+
+static const int lk_breadth[] = LK_BREADTH;
+
+#pragma region static_functions
+
+/// @brief true if the edge (a,b) is among the ones added by the first depth steps
+static char lk_added(const lk_state* lk, const unsigned int depth, const int a, const int b) {
+    for(unsigned int d = 0; d < depth; d++) {
+        const lk_step* s = &lk->step[d];
+        if((s->t2 == a && s->t3 == b) || (s->t2 == b && s->t3 == a)) return 1;
+    }
+    return 0;
+}
+
+
+/// @brief true if the edge (a,b) is among the ones removed by the first depth steps (or is (t1,t2))
+static char lk_removed(const lk_state* lk, const unsigned int depth, const int a, const int b) {
+    if((lk->t1 == a && lk->t2 == b) || (lk->t1 == b && lk->t2 == a)) return 1;
+    for(unsigned int d = 0; d < depth; d++) {
+        const lk_step* s = &lk->step[d];
+        if((s->t3 == a && s->t4 == b) || (s->t3 == b && s->t4 == a)) return 1;
+    }
+    return 0;
+}
+
+
+/// @brief undo the steps [from, lk->depth) in reverse order
+static void lk_undo(lk_state* lk, const unsigned int from) {
+    for(int d = (int) lk->depth - 1; d >= (int) from; d--)
+        tour_flip_path(lk->tour, lk->step[d].t4, lk->step[d].t2, lk->t1);
+    lk->depth = from;
+}
+
+
+/// @brief one level of the variable-depth search: the tour is closed by (t1,t2), whose removal
+///        leaves gain; every step adds (t2,t3) for a candidate t3, removes (t3,t4) and closes with
+///        (t4,t1) through one reversal, so a chain of two steps is a sequential 3opt move. The
+///        steps are tried by decreasing d(t3,t4) - d(t2,t3): the first levels backtrack over
+///        lk_breadth alternatives, the deeper ones follow the best one
+/// @param lk search state (tour and applied steps)
+/// @param t2 free end of the tour
+/// @param gain removed minus added length so far
+/// @param depth number of applied steps
+/// @return best improvement found (the tour is left in that state, lk->depth steps applied), 0 if none
+static double lk_search(lk_state* lk, const int t2, const double gain, const unsigned int depth) {
+    if(depth >= LK_MAX_DEPTH) return 0;
+
+    const TSPinst* inst = lk->inst;
+    const double eps = COST_EPS(inst);
+    const int t1 = lk->t1;
+    const int* cand = inst->cand + (size_t) t2 * inst->cand_k;
+    const int breadth = (depth < sizeof(lk_breadth) / sizeof(lk_breadth[0])) ? lk_breadth[depth] : 1;
+
+    // t4 is the neighbour of t3 on the side of t2, walking away from t1
+    const char forward = (tour_next(lk->tour, t1) == t2);
+
+    lk_choice choice[LK_MAX_BREADTH] = {{0}};
+    int nchoice = 0;
+    for(int h = 0; h < inst->cand_k; h++) {
+        const int t3 = cand[h];
+        const double g1 = gain - get_arc(inst, t2, t3);
+        if(g1 <= eps) break;
+        if(t3 == t1) continue;
+
+        const int t4 = forward ? tour_prev(lk->tour, t3) : tour_next(lk->tour, t3);
+        if(t4 == t2 || lk_removed(lk, depth, t2, t3) || lk_added(lk, depth, t3, t4)) continue;
+
+        // keep the breadth best steps, sorted by g2
+        const double g2 = g1 + get_arc(inst, t3, t4);
+        int c = (nchoice < breadth) ? nchoice++ : breadth;
+        while(c > 0 && choice[c-1].g2 < g2) {
+            if(c < breadth) choice[c] = choice[c-1];
+            c--;
+        }
+        if(c < breadth) choice[c] = (lk_choice) {.t3 = t3, .t4 = t4, .g2 = g2};
+    }
+
+    for(int c = 0; c < nchoice; c++) {
+        const int t3 = choice[c].t3, t4 = choice[c].t4;
+
+        tour_flip_path(lk->tour, t2, t4, t1);
+        lk->step[depth] = (lk_step) {.t2 = t2, .t3 = t3, .t4 = t4};
+        lk->depth = depth+1;
+
+        const double close = choice[c].g2 - get_arc(inst, t4, t1);
+        const double deeper = lk_search(lk, t4, choice[c].g2, depth+1);
+
+        if(deeper > 0 && deeper >= close) return deeper;
+        if(close > eps) {
+            lk_undo(lk, depth+1);
+            return close;
+        }
+        lk_undo(lk, depth);
+    }
+    return 0;
+}
+
+#pragma endregion
+
+
+/// @brief execute a Lin-Kernighan style variable-depth search on the candidate lists with
+///        don't-look bits: from every active node t1 (both tour neighbours as t2) lk_search looks
+///        for an improving chain of reversals; the nodes of an applied chain are queued again
+///        (best cross policy if the instance has no candidates)
+/// @param inst instance of TSPinst 
+/// @param tour hamiltionian circuit
+/// @param cost cost of path
+void TSPlk(const TSPinst* inst, const TSPenv* env, double init_time, int* tour, double* cost) {
+    if(inst->cand == NULL || inst->nnodes < 8) { TSPg2optb(inst, env, init_time, tour, cost); return; }
+
+    const unsigned int n = inst->nnodes;
+    TSPtour* t = tour_new(tour, n, TOUR_AUTO(n));
+    int* queue = (int*) malloc(n * sizeof(int));
+    char* active = (char*) malloc(n * sizeof(char));
+
+    for(int k = 0; k < n; k++) { queue[k] = tour[k]; active[tour[k]] = 1; }
+    unsigned int head = 0, size = n;
+
+    lk_state lk = { .inst = inst, .tour = t };
+
+    while (size && REMAIN_TIME(init_time, env)) {
+        int t1 = queue[head];
+        head = (head+1 == n) ? 0 : head+1;
+        size--;
+        active[t1] = 0;
+
+        for(int side = 0; side < 2; side++) {
+            lk.t1 = t1;
+            lk.t2 = side ? tour_prev(t, t1) : tour_next(t, t1);
+            lk.depth = 0;
+
+            double gain = lk_search(&lk, lk.t2, get_arc(inst, t1, lk.t2), 0);
+            if(gain <= 0) continue;
+            *cost -= gain;
+
+            int ends[2] = { t1, lk.t2 };
+            for(int e = 0; e < 2 + 2 * (int) lk.depth; e++) {
+                int node = (e < 2) ? ends[e] : (e % 2) ? lk.step[(e-2)/2].t4 : lk.step[(e-2)/2].t3;
+                if(active[node]) continue;
+                queue[(head + size) % n] = node;
+                active[node] = 1;
+                size++;
+            }
+
+            #if VERBOSE > 2
+                tour_get(t, tour);
+                check_tour_cost(inst, tour, *cost);
+            #endif
+            break;
+        }
+    }
+
+    tour_get(t, tour);
+    tour_delete(t);
+    free(queue);
+    free(active);
+}
@@ -0,0 +1,324 @@
+#include "../include/tsp_parser.h"
+#include <fcntl.h>
+
+#pragma region static_functions
+
+static const double scan_pow10[SCAN_EXACT_POW + 1] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+
+/// @brief skip spaces, tabs and line breaks
+static inline void scan_blank(tsp_scanner* sc) {
+    while(sc->cur < sc->end && (*sc->cur == ' ' || *sc->cur == '\t' || *sc->cur == '\r' || *sc->cur == '\n')) sc->cur++;
+}
+
+
+/// @brief skip spaces and tabs (stay on the current line)
+static inline void scan_space(tsp_scanner* sc) {
+    while(sc->cur < sc->end && (*sc->cur == ' ' || *sc->cur == '\t' || *sc->cur == '\r')) sc->cur++;
+}
+
+
+/// @brief move to the beginning of the next line
+static inline void scan_line(tsp_scanner* sc) {
+    const char* nl = memchr(sc->cur, '\n', sc->end - sc->cur);
+    sc->cur = (nl == NULL) ? sc->end : nl + 1;
+}
+
+
+/// @brief read a keyword ([A-Za-z0-9_] characters)
+/// @param sc scanner
+/// @param dest destination (truncated to SCAN_TOKEN-1 characters)
+/// @return length of the keyword, 0 if the next character cannot start one
+static size_t scan_word(tsp_scanner* sc, char* dest) {
+    size_t len = 0;
+    while(sc->cur < sc->end) {
+        char c = *sc->cur;
+        if(!((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_')) break;
+        if(len < SCAN_TOKEN - 1) dest[len++] = c;
+        sc->cur++;
+    }
+    dest[len] = '\0';
+    return len;
+}
+
+
+/// @brief read a decimal number (sign, digits, fraction, exponent): exact fast path when the
+///        mantissa fits 53 bits and the power of ten is exactly representable, strtod otherwise
+/// @param sc scanner (leading blanks are skipped)
+/// @param out parsed value
+/// @return 1 if a number was read, 0 otherwise (scanner left on the first non-blank character)
+static char scan_number(tsp_scanner* sc, double* out) {
+    scan_blank(sc);
+    const char* p = sc->cur;
+    const char* start = p;
+
+    char neg = 0;
+    if(p < sc->end && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+
+    uint64_t mant = 0;
+    int digits = 0, exp10 = 0, seen = 0;
+    for(; p < sc->end && *p >= '0' && *p <= '9'; p++, seen++) {
+        if(digits < SCAN_DIGITS) { mant = mant * 10 + (*p - '0'); if(mant) digits++; }
+        else exp10++;
+    }
+    if(p < sc->end && *p == '.') {
+        for(p++; p < sc->end && *p >= '0' && *p <= '9'; p++, seen++) {
+            if(digits < SCAN_DIGITS) { mant = mant * 10 + (*p - '0'); if(mant) digits++; exp10--; }
+        }
+    }
+    if(!seen) return 0;
+
+    if(p < sc->end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        char eneg = 0;
+        if(q < sc->end && (*q == '-' || *q == '+')) eneg = (*q++ == '-');
+        if(q < sc->end && *q >= '0' && *q <= '9') {
+            int e = 0;
+            for(; q < sc->end && *q >= '0' && *q <= '9'; q++) if(e < 10000) e = e * 10 + (*q - '0');
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+    sc->cur = p;
+
+    if(mant < (1ULL << 53) && exp10 >= -SCAN_EXACT_POW && exp10 <= SCAN_EXACT_POW) {
+        double v = (exp10 < 0) ? mant / scan_pow10[-exp10] : mant * scan_pow10[exp10];
+        *out = neg ? -v : v;
+        return 1;
+    }
+
+    // slow path on a NUL-terminated copy (the buffer is not terminated)
+    char token[SCAN_TOKEN];
+    size_t len = (p - start < SCAN_TOKEN - 1) ? p - start : SCAN_TOKEN - 1;
+    memcpy(token, start, len);
+    token[len] = '\0';
+    *out = strtod(token, NULL);
+    return 1;
+}
+
+
+/// @brief read the whole file in memory: mmap for plain text, "gzip -dc" for gzip input
+/// @param file name of the file
+/// @param size size of the content
+/// @param mapped set to 1 if the content must be released with munmap, 0 with free
+/// @return content of the file
+static char* tsplib_load(const char* file, size_t* size, char* mapped) {
+    int fd = open(file, O_RDONLY);
+    if(fd < 0) print_state(Error, "input file not found!");
+
+    unsigned char magic[2] = { 0 };
+    char gzip = (read(fd, magic, 2) == 2 && magic[0] == 0x1f && magic[1] == 0x8b);
+
+    if(!gzip) {
+        struct stat st;
+        if(fstat(fd, &st) || st.st_size == 0) print_state(Error, " format error: empty input file!");
+
+        char* buf = (char*) mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(buf == MAP_FAILED) print_state(Error, " failed to map input file!");
+        madvise(buf, st.st_size, MADV_SEQUENTIAL);
+
+        *size = st.st_size;
+        *mapped = 1;
+        return buf;
+    }
+    close(fd);
+
+    if(strchr(file, '\'') != NULL) print_state(Error, " gzip input file names cannot contain quotes!");
+    char* cmd = (char*) malloc(strlen(file) + 32);
+    sprintf(cmd, "gzip -dc -- '%s'", file);
+    FILE* pipe = popen(cmd, "r");
+    free(cmd);
+    if(pipe == NULL) print_state(Error, " failed to run gzip on input file!");
+
+    size_t cap = 1 << 20, len = 0, got;
+    char* buf = (char*) malloc(cap);
+    while((got = fread(buf + len, 1, cap - len, pipe)) > 0) {
+        len += got;
+        if(len == cap) buf = (char*) realloc(buf, cap <<= 1);
+        if(buf == NULL) print_state(Error, " failed to allocate memory for input file!");
+    }
+    if(pclose(pipe) != 0 || len == 0) print_state(Error, " failed to decompress input file!");
+
+    *size = len;
+    *mapped = 0;
+    return buf;
+}
+
+
+/// @brief parse a NODE_COORD_SECTION / DISPLAY_DATA_SECTION ("id x y" lines)
+/// @param inst instance of TSPinst (DIMENSION already read)
+/// @param sc scanner positioned after the section keyword
+static void tsplib_coords(TSPinst* inst, tsp_scanner* sc) {
+    if(inst->points == NULL) print_state(Error, " format error: DIMENSION must precede the coordinates!");
+
+    double id, x, y;
+    while(scan_number(sc, &id)) {
+        if(!scan_number(sc, &x) || !scan_number(sc, &y)) print_state(Error, " format error: bad coordinate line!");
+
+        int i = (int) id - 1;
+        if(i >= 0 && i < inst->nnodes) inst->points[i] = (point) { .x = x, .y = y };
+    }
+}
+
+
+/// @brief parse an EDGE_WEIGHT_SECTION straight into the distance table
+/// @param inst instance of TSPinst (DIMENSION already read)
+/// @param env instance of TSPenv (storage type and layout)
+/// @param sc scanner positioned after the section keyword
+/// @param format weight format (full matrix or one of the row triangles)
+static void tsplib_weights(TSPinst* inst, const TSPenv* env, tsp_scanner* sc, const int format) {
+    if(inst->nnodes == 0) print_state(Error, " format error: DIMENSION must precede the edge weights!");
+    if(inst->edge_type != EXPLICIT) print_state(Error, " format error: EDGE_WEIGHT_SECTION needs EDGE_WEIGHT_TYPE: EXPLICIT!");
+
+    TSPdist* dist = dist_explicit_new(inst, env);
+    const int n = inst->nnodes;
+
+    for(int i = 0; i < n; i++) {
+        int first, last;
+        switch (format) {
+            case UpperRow:      first = i + 1;  last = n - 1;   break;
+            case LowerRow:      first = 0;      last = i - 1;   break;
+            case UpperDiagRow:  first = i;      last = n - 1;   break;
+            case LowerDiagRow:  first = 0;      last = i;       break;
+            default:            first = 0;      last = n - 1;   break;
+        }
+
+        for(int j = first; j <= last; j++) {
+            double w;
+            if(!scan_number(sc, &w)) print_state(Error, " format error: too few edge weights!");
+            if(i != j) dist_store(dist, i, j, w);
+        }
+    }
+
+    inst->dist = dist;
+}
+
+/// @brief print a number with the fewest digits that read back as the same double
+/// @param f destination file
+/// @param v coordinate or weight
+static void tsplib_put_number(FILE* f, const double v) {
+    char buf[SCAN_TOKEN];
+    snprintf(buf, sizeof(buf), "%.15g", v);
+    if(strtod(buf, NULL) != v) snprintf(buf, sizeof(buf), "%.17g", v);
+    fputs(buf, f);
+}
+
+#pragma endregion
+
+
+/// @brief parser of TSPLIB .tsp files (also gzip compressed): a single pass over the mapped file
+///        with a hand-written number scanner; EDGE_WEIGHT_TYPE EUC_2D, CEIL_2D, ATT, GEO and
+///        EXPLICIT (FULL_MATRIX, UPPER_ROW, LOWER_ROW, UPPER_DIAG_ROW, LOWER_DIAG_ROW)
+/// @param inst instance of TSPinst
+/// @param env instance of TSPenv (explicit weights are stored with its type and layout)
+/// @param file name of .tsp file
+void tsplib_read(TSPinst* inst, const TSPenv* env, const char* file) {
+    size_t size;
+    char mapped;
+    char* buf = tsplib_load(file, &size, &mapped);
+
+    tsp_scanner sc = { .cur = buf, .end = buf + size };
+    int format = FullMatrix;
+    char key[SCAN_TOKEN], value[SCAN_TOKEN];
+
+    while(1) {
+        scan_blank(&sc);
+        if(sc.cur >= sc.end) break;
+        if(!scan_word(&sc, key)) { scan_line(&sc); continue; }
+
+        if(!strcmp(key, "EOF")) break;
+        if(!strcmp(key, "NODE_COORD_SECTION") || !strcmp(key, "DISPLAY_DATA_SECTION")) { tsplib_coords(inst, &sc); continue; }
+        if(!strcmp(key, "EDGE_WEIGHT_SECTION")) { tsplib_weights(inst, env, &sc, format); continue; }
+
+        scan_space(&sc);
+        if(sc.cur < sc.end && *sc.cur == ':') sc.cur++;
+        scan_space(&sc);
+
+        if(!strcmp(key, "TYPE")) {
+            scan_word(&sc, value);
+            if(strcmp(value, "TSP")) print_state(Error, " format error: only TYPE: TSP implemented!");
+        }
+        else if(!strcmp(key, "DIMENSION")) {
+            double n;
+            if(inst->nnodes > 0) print_state(Error, " repeated DIMENSION section in input file!");
+            if(!scan_number(&sc, &n) || n < 2) print_state(Error, " format error: bad DIMENSION!");
+
+            inst->nnodes = (unsigned int) n;
+            inst->points = (point *) calloc(inst->nnodes, sizeof(point));
+            inst->solution = malloc(inst->nnodes * sizeof(int));
+            if (inst->points == NULL) print_state(Error, " failed to allocate memory for points vector!");
+        }
+        else if(!strcmp(key, "EDGE_WEIGHT_TYPE")) {
+            scan_word(&sc, value);
+            if(!strcmp(value, "EUC_2D"))        inst->edge_type = EUC_2D;
+            else if(!strcmp(value, "CEIL_2D"))  inst->edge_type = CEIL_2D;
+            else if(!strcmp(value, "ATT"))      inst->edge_type = ATT;
+            else if(!strcmp(value, "GEO"))      inst->edge_type = GEO;
+            else if(!strcmp(value, "EXPLICIT")) inst->edge_type = EXPLICIT;
+            else print_state(Error, " format error: EDGE_WEIGHT_TYPE %s not implemented!\n", value);
+        }
+        else if(!strcmp(key, "EDGE_WEIGHT_FORMAT")) {
+            scan_word(&sc, value);
+            if(!strcmp(value, "FULL_MATRIX"))           format = FullMatrix;
+            else if(!strcmp(value, "UPPER_ROW"))        format = UpperRow;
+            else if(!strcmp(value, "LOWER_ROW"))        format = LowerRow;
+            else if(!strcmp(value, "UPPER_DIAG_ROW"))   format = UpperDiagRow;
+            else if(!strcmp(value, "LOWER_DIAG_ROW"))   format = LowerDiagRow;
+            else if(strcmp(value, "FUNCTION")) print_state(Error, " format error: EDGE_WEIGHT_FORMAT %s not implemented!\n", value);
+        }
+
+        scan_line(&sc);
+    }
+
+    if(mapped) munmap(buf, size);
+    else free(buf);
+
+    if(inst->nnodes == 0) print_state(Error, " format error: missing DIMENSION!");
+    if(inst->edge_type == EXPLICIT && inst->dist == NULL) print_state(Error, " format error: missing EDGE_WEIGHT_SECTION!");
+}
+
+
+/// @brief write an instance as a TSPLIB .tsp file: NODE_COORD_SECTION with the original node
+///        ids (coordinates read back bit-exact), or the UPPER_ROW weights of an EXPLICIT instance
+/// @param inst instance of TSPinst
+/// @param file name of the destination file
+void tsplib_write(const TSPinst* inst, const char* file) {
+    static const char* edge_name[] = { "EUC_2D", "ATT", "CEIL_2D", "GEO", "EXPLICIT" };
+
+    FILE* f = fopen(file, "w");
+    if(f == NULL) print_state(Error, " failed to open output file!");
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+
+    const char* name = strrchr(file, '/');
+    fprintf(f, "NAME : %s\nTYPE : TSP\n", (name != NULL) ? name + 1 : file);
+    if(inst->random_seed) fprintf(f, "COMMENT : random instance, seed %u\n", inst->random_seed);
+    fprintf(f, "DIMENSION : %u\nEDGE_WEIGHT_TYPE : %s\n", inst->nnodes, edge_name[inst->edge_type]);
+
+    if(inst->edge_type == EXPLICIT) {
+        fprintf(f, "EDGE_WEIGHT_FORMAT : UPPER_ROW\nEDGE_WEIGHT_SECTION\n");
+        for(int i = 0; i < inst->nnodes; i++) {
+            for(int j = i + 1; j < inst->nnodes; j++) { tsplib_put_number(f, get_arc(inst, i, j)); fputc(' ', f); }
+            if(i + 1 < inst->nnodes) fputc('\n', f);
+        }
+    }
+    else {
+        fprintf(f, "NODE_COORD_SECTION\n");
+        for(int i = 0; i < inst->nnodes; i++) {
+            fprintf(f, "%d ", instance_node_id(inst, i) + 1);
+            tsplib_put_number(f, inst->xcoord[i]);
+            fputc(' ', f);
+            tsplib_put_number(f, inst->ycoord[i]);
+            fputc('\n', f);
+        }
+    }
+    fprintf(f, "EOF\n");
+
+    if(fclose(f)) print_state(Error, " failed to write TSPLIB file!");
+
+    #if VERBOSE > 0
+        print_state(Info, "TSPLIB instance written on %s\n", file);
+    #endif
+}
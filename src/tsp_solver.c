@@ -5,64 +5,203 @@
 
 static mt_context* GREEDY_MT_CTX;
 
-static void* greedy_job(void* userhandle){
-    mt_greedy_pars pars = *(mt_greedy_pars*) userhandle;
+/// @brief order of the greedy starts: cost of the greedy tour, then starting node
+static inline char slot_less(const double key, const unsigned int start, const greedy_slot* slot) {
+    return key < slot->key || (key == slot->key && start < slot->start);
+}
+
+
+/// @brief offer a greedy tour to the bounded set of starts: it takes a free slot or replaces the
+///        worst one, otherwise it is dropped (call with the mutex held)
+/// @param pars pointer to mt_greedy_pars
+/// @param sol greedy tour
+/// @param start starting node of the tour
+static void greedy_offer(mt_greedy_pars* pars, const TSPsol sol, const unsigned int start) {
+    greedy_slot* slots = pars->mt_slots;
+    unsigned int s = pars->mt_nslots;
 
-    TSPsol my_min = { .cost = INFINITY, .tour = NULL };
+    if(sol.cost < pars->mt_best_greedy) pars->mt_best_greedy = sol.cost;
+
+    if(s < pars->mt_cap) pars->mt_nslots++;
+    else {
+        s = 0;
+        for(unsigned int j = 1; j < pars->mt_cap; j++) if(slot_less(slots[s].key, slots[s].start, &slots[j])) s = j;
+        if(!slot_less(sol.cost, start, &slots[s])) { free(sol.tour); return; }
+
+        // a slot under improvement has no tour: its result is dropped when it comes back
+        free(slots[s].sol.tour);
+    }
+    slots[s] = (greedy_slot) { .sol = sol, .key = sol.cost, .start = start, .gen = slots[s].gen + 1, .state = Built };
+}
 
-    int my_id;
-    for(my_id=0;(pthread_self() != GREEDY_MT_CTX->threads[my_id]) && my_id< GREEDY_MT_CTX->num_threads;my_id++);
 
-    int load = pars.mt_inst->nnodes/GREEDY_MT_CTX->num_threads;
-    int end = (my_id != GREEDY_MT_CTX->num_threads-1) ? (my_id+1) * load: pars.mt_inst->nnodes;
+/// @brief best start not improved yet among the ones within GREEDY_GAP of the best greedy tour
+/// @param pars pointer to mt_greedy_pars
+/// @return index of the slot, -1 if there is none
+static int greedy_pick(const mt_greedy_pars* pars) {
+    const double bound = pars->mt_best_greedy * (1.0 + GREEDY_GAP);
+    int best = -1;
 
-    for(int i = my_id * load; i < end && REMAIN_TIME(pars.mt_init_time,pars.mt_env); i++){
-        TSPsol tmp = TSPgreedy(pars.mt_inst, pars.mt_env, i, pars.mt_opt_fun, pars.mt_env->method, pars.mt_init_time);
-        if(tmp.cost < my_min.cost) { my_min = tmp; }
+    for(unsigned int j = 0; j < pars->mt_nslots; j++) {
+        const greedy_slot* slot = &pars->mt_slots[j];
+        if(slot->state != Built || slot->key > bound) continue;
+        if(best < 0 || slot_less(slot->key, slot->start, &pars->mt_slots[best])) best = j;
     }
+    return best;
+}
+
+
+/// @brief worker of the multi-start pipeline: build greedy tours from the starting nodes while
+///        the construction budget lasts, then improve the best ones kept in the bounded set
+/// @param userhandle pointer to mt_greedy_pars
+static void* greedy_job(void* userhandle){
+    mt_greedy_pars* pars = (mt_greedy_pars*) userhandle;
+    pthread_mutex_t* mutex = &GREEDY_MT_CTX->mutex;
+
+    pthread_mutex_lock(mutex);
+    for(;;) {
+        if(pars->mt_next_start < pars->mt_inst->nnodes && time_elapsed(pars->mt_init_time) <= pars->mt_build_time) {
+            unsigned int i = pars->mt_next_start++;
+            pars->mt_building++;
+            pthread_mutex_unlock(mutex);
+
+            // without top-k filtering every start is improved right away and only the best tour is kept
+            TSPsol tmp = TSPgreedy(pars->mt_inst, pars->mt_env, i, pars->mt_filter ? NULL : pars->mt_opt_fun, pars->mt_env->method, pars->mt_init_time);
+
+            pthread_mutex_lock(mutex);
+            pars->mt_building--;
+            greedy_offer(pars, tmp, i);
+            pthread_cond_broadcast(&pars->mt_ready);
+            continue;
+        }
+
+        // construction is closed: the set can still change while the last tours are built,
+        // an improved start that is pushed out meanwhile is simply dropped
+        int s = (pars->mt_filter && REMAIN_TIME(pars->mt_init_time, pars->mt_env)) ? greedy_pick(pars) : -1;
+        if(s >= 0) {
+            greedy_slot* slot = &pars->mt_slots[s];
+            TSPsol sol = slot->sol;
+            unsigned int gen = slot->gen;
+            #if VERBOSE > 1
+            unsigned int start = slot->start;
+            #endif
+            slot->sol.tour = NULL;
+            slot->state = Taken;
+            pthread_mutex_unlock(mutex);
+
+            ((opt_fun) pars->mt_opt_fun)(pars->mt_inst, pars->mt_env, pars->mt_init_time, sol.tour, &sol.cost);
+
+            #if VERBOSE > 1
+            printf("Partial \e[1m%7s\e[m solution starting from [%i]: \t%10.4f\n", pars->mt_env->method, start, sol.cost);
+            #endif
 
-    pthread_mutex_lock(&GREEDY_MT_CTX->mutex);
-        if(my_min.cost < pars.mt_greedy_sol->cost)  *pars.mt_greedy_sol = my_min;    
-    pthread_mutex_unlock(&GREEDY_MT_CTX->mutex);
+            pthread_mutex_lock(mutex);
+            slot = &pars->mt_slots[s];
+            if(slot->gen == gen) { slot->sol = sol; slot->state = Improved; }
+            else free(sol.tour);
+            continue;
+        }
+
+        if(pars->mt_building == 0) break;
+        pthread_cond_wait(&pars->mt_ready, mutex);
+    }
+    pthread_mutex_unlock(mutex);
     return NULL;
 }
 
 
+/// @brief true if -init asks for the greedy edge construction
+static inline char edge_start(const TSPenv* env) {
+    char* edge_init[] = {"GREEDY_EDGE", "EDGE"};
+    return strnin(env->init_method, edge_init, 2);
+}
+
+
 /// @brief Solve an instance of TSP with an heuristic approach
 /// @param inst instance of TSPinst
 /// @param env instance of TSPenv
 void TSPsolve(TSPinst* inst, TSPenv* env) {
-    char* null_func[] = {"GREEDY", "TABU_R", "VNS"};
+    char* null_func[] = {"GREEDY", "GREEDY_EDGE", "TABU_R", "VNS"};
     char* optb_func[] = {"G2OPT_B", "TABU_B"};
     char* optf_func[] = {"G2OPT_F"};
+    char* optnl_func[] = {"G2OPT_NL"};
+    char* orof_func[] = {"OROPT_F"};
+    char* orob_func[] = {"OROPT_B"};
+    char* lk_func[] = {"LK"};
+    char* karp_func[] = {"KARP"};
     void* opt_func;
 
 
     //set_improvement function
-    if(strnin(env->method, null_func, 3)) { opt_func = NULL; }
+    if(strnin(env->method, null_func, 4)) { opt_func = NULL; }
     else if(strnin(env->method, optf_func, 1)) { opt_func = TSPg2opt; }
     else if(strnin(env->method, optb_func, 2)) { opt_func = TSPg2optb; }
+    else if(strnin(env->method, optnl_func, 1)) { opt_func = TSPg2optnl; }
+    else if(strnin(env->method, orof_func, 1)) { opt_func = TSPoropt; }
+    else if(strnin(env->method, orob_func, 1)) { opt_func = TSPoroptb; }
+    else if(strnin(env->method, lk_func, 1)) { opt_func = TSPlk; }
+    else if(strnin(env->method, karp_func, 1)) { opt_func = TSPkarp; }
     else { print_state(Error, "No function with alias"); }
 
 
     #if VERBOSE > 1
-        print_state(Info,"Multithreading on %d threads\n",(int) log2(inst->nnodes*(inst->nnodes-1)/2));
+        print_state(Info,"Multithreading on %d threads\n",mt_pool_size());
     #endif
     
     double init_time = get_time();
 
     TSPsol min = { .cost = INFINITY, .tour = NULL };
 
-    mt_greedy_pars greedy_par ={.mt_inst=inst,
-                                .mt_opt_fun=opt_func,
-                                .mt_init_time=init_time,
-                                .mt_env=env,
-                                .mt_greedy_sol=&min};
+    // the greedy edge tour does not depend on a starting node: it is built (and improved) once
+    char* edge_func[] = {"GREEDY_EDGE"};
+    if(strnin(env->method, edge_func, 1) || edge_start(env)) { min = TSPgreedy_edge(inst, env, opt_func, env->method, init_time); }
+    else {
+        // -topk k > 0 keeps the k best greedy tours and improves only those; by default every start
+        // is improved as soon as it is built and only the best tour is kept
+        char filter = (opt_func != NULL && env->topk > 0);
+        unsigned int cap = !filter ? 1 : (env->topk > inst->nnodes) ? inst->nnodes : env->topk;
+
+        mt_greedy_pars greedy_par ={.mt_inst=inst,
+                                    .mt_opt_fun=opt_func,
+                                    .mt_init_time=init_time,
+                                    .mt_build_time=!filter ? env->time_limit : GREEDY_BUILD_SHARE * env->time_limit,
+                                    .mt_env=env,
+                                    .mt_slots=(greedy_slot*) calloc(cap, sizeof(greedy_slot)),
+                                    .mt_nslots=0,
+                                    .mt_cap=cap,
+                                    .mt_filter=filter,
+                                    .mt_best_greedy=INFINITY,
+                                    .mt_building=0,
+                                    .mt_ready=PTHREAD_COND_INITIALIZER,
+                                    .mt_next_start=0};
+
+        GREEDY_MT_CTX = new_mt_context(mt_pool_size(),HANDLE_MTX);
+        run_job(GREEDY_MT_CTX,greedy_job,&greedy_par);
+        delete_mt_context(GREEDY_MT_CTX,HANDLE_MTX);
+        pthread_cond_destroy(&greedy_par.mt_ready);
+
+        // with -topk the starts within the gap of the final best greedy tour are all improved (time
+        // allowing): the winner does not depend on the order in which the threads built them
+        int best = -1;
+        for(unsigned int j = 0; j < greedy_par.mt_nslots; j++) {
+            greedy_slot* slot = &greedy_par.mt_slots[j];
+            if(slot->sol.tour == NULL || (filter && slot->key > greedy_par.mt_best_greedy * (1.0 + GREEDY_GAP))) continue;
+            if(best < 0 || slot->sol.cost < greedy_par.mt_slots[best].sol.cost ||
+                (slot->sol.cost == greedy_par.mt_slots[best].sol.cost && slot->start < greedy_par.mt_slots[best].start)) best = j;
+        }
+        for(unsigned int j = 0; j < greedy_par.mt_nslots; j++) {
+            if(j == best) min = greedy_par.mt_slots[j].sol;
+            else free(greedy_par.mt_slots[j].sol.tour);
+        }
 
-    GREEDY_MT_CTX = new_mt_context((int) log2(inst->nnodes*(inst->nnodes-1)/2),HANDLE_MTX);
-    run_job(GREEDY_MT_CTX,greedy_job,&greedy_par);
-    delete_mt_context(GREEDY_MT_CTX,HANDLE_MTX);
-    
+        #if VERBOSE > 1
+            unsigned int improved = 0;
+            for(unsigned int j = 0; j < greedy_par.mt_nslots; j++) improved += (greedy_par.mt_slots[j].state == Improved);
+            if(filter) print_state(Info, "Greedy built from %u starts, %u of the best %u improved\n", greedy_par.mt_next_start, improved, greedy_par.mt_nslots);
+            else print_state(Info, "Greedy built from %u starts\n", greedy_par.mt_next_start);
+        #endif
+        free(greedy_par.mt_slots);
+    }
 
     instance_set_solution(inst, min.tour, min.cost);
 
@@ -83,7 +222,7 @@ void TSPsolve(TSPinst* inst, TSPenv* env) {
 }
 
 
-/// @brief find a solution to TSP using gredy approach
+/// @brief find a solution to TSP using gredy approach (nearest unvisited node from the instance k-d tree, or a linear scan without planar geometry)
 /// @param inst instance of TSPinst
 /// @param intial_node intial node
 /// @param tsp_func improvement function
@@ -91,18 +230,34 @@ TSPsol TSPgreedy(const TSPinst* inst, const TSPenv* env, const unsigned int inti
 
     TSPsol out = { .cost = 0.0, .tour = malloc(inst->nnodes * sizeof(int)) };
 
-    int current_index = intial_node;
-    char used_node[inst->nnodes];
-    bzero( used_node, inst->nnodes * sizeof(char) );
-    used_node[intial_node] = 1;
-    out.tour[0] = current_index;
+    out.tour[0] = intial_node;
+
+    if(inst->kdtree != NULL) {
+        kd_query* unvisited = kdquery_new(inst->kdtree);
+        kdquery_remove(unvisited, intial_node);
+
+        for (int i = 1; i < inst->nnodes; i++) {  
+            int next = kdquery_nearest(unvisited, out.tour[i-1], NULL);
+
+            out.cost += get_arc(inst, out.tour[i-1], next);
+            kdquery_remove(unvisited, next);
+            out.tour[i] = next;
+        }
+        kdquery_delete(unvisited);
+    }
+    else {
+        // no planar geometry (GEO, EXPLICIT): linear scan of the unvisited nodes
+        char* used_node = (char*) calloc(inst->nnodes, sizeof(char));
+        used_node[intial_node] = 1;
 
-    for (int i = 1; i < inst->nnodes; i++) {  
-        near_neighbor new_point = get_nearest_neighbor(inst, out.tour[i-1], used_node);
+        for (int i = 1; i < inst->nnodes; i++) {
+            near_neighbor new_point = get_nearest_neighbor(inst, out.tour[i-1], used_node);
 
-        out.cost += new_point.dist;
-        used_node[new_point.index] = 1;
-        out.tour[i] = new_point.index;
+            out.cost += new_point.dist;
+            used_node[new_point.index] = 1;
+            out.tour[i] = new_point.index;
+        }
+        free(used_node);
     }
     out.cost += get_arc(inst, out.tour[inst->nnodes-1], intial_node);
 
@@ -122,43 +277,242 @@ TSPsol TSPgreedy(const TSPinst* inst, const TSPenv* env, const unsigned int inti
 }
 
 
-/// @brief execute G2Opt using first cross policy 
+/// @brief starting tour set by -init: nearest neighbor from the given node, or greedy edge (the node is ignored)
+/// @param inst instance of TSPinst
+/// @param intial_node intial node of the nearest neighbor tour
+/// @param tsp_func improvement function
+TSPsol TSPstart(const TSPinst* inst, const TSPenv* env, const unsigned int intial_node, void(tsp_func)(const TSPinst*, const TSPenv*,double, int*, double*), char* func_name, double init_time) {
+    if(edge_start(env)) return TSPgreedy_edge(inst, env, tsp_func, func_name, init_time);
+    return TSPgreedy(inst, env, intial_node, tsp_func, func_name, init_time);
+}
+
+
+/// @brief execute G2Opt using first cross policy: every round the row blocks are searched in
+///        parallel and the batch of their first improving crosses that do not overlap is applied
 /// @param inst instance of TSPinst 
 /// @param tour hamiltionian circuit
 /// @param cost cost of path
 void TSPg2opt(const TSPinst* inst,const TSPenv* env, double init_time, int* tour, double* cost) {
+    const unsigned int n = inst->nnodes;
+    TSPtour* t = tour_new(tour, n, Array);
+    cross* batch = (cross*) malloc(n * sizeof(cross));
+    int* ends = (int*) malloc(3 * n * sizeof(int));
 
     while (REMAIN_TIME(init_time, env)) {
-        cross curr_cross = find_first_cross(inst, tour);
-        if(curr_cross.delta_cost >= -EPSILON) return;
-        
-        reverse(tour,curr_cross.i+1,curr_cross.j);
-        *cost+=curr_cross.delta_cost;
+        int nmoves = find_first_crosses(inst, tour, batch);
+        if(nmoves == 0) break;
+
+        // crosses as nodes first: a flip of the shorter side moves the positions of the others
+        for(int k = 0; k < nmoves; k++) {
+            ends[3*k] = tour[batch[k].i];
+            ends[3*k+1] = tour[batch[k].i+1];
+            ends[3*k+2] = tour[batch[k].j];
+        }
+        for(int k = 0; k < nmoves; k++) {
+            tour_flip_path(t, ends[3*k+1], ends[3*k+2], ends[3*k]);
+            *cost+=batch[k].delta_cost;
+        }
 
         #if VERBOSE > 2
             check_tour_cost(inst, tour, *cost);
         #endif
     }
+
+    free(batch);
+    free(ends);
+    tour_delete(t);
 }
 
 
-/// @brief execute G2Opt using best cross policy 
+/// @brief execute G2Opt using best cross policy: over the candidate lists the best move comes
+///        from a cross_cache, otherwise every pair of arcs is scanned at each step
 /// @param inst instance of TSPinst 
 /// @param tour hamiltionian circuit
 /// @param cost cost of path
 void TSPg2optb(const TSPinst* inst,const TSPenv* env, double init_time, int* tour, double* cost) {
+    if(inst->cand != NULL) {
+        TSPtour* t = tour_new(tour, inst->nnodes, TOUR_AUTO(inst->nnodes));
+        cross_cache* cache = cross_cache_new(inst, t, NULL, 0);
+
+        while (REMAIN_TIME(init_time, env)) {
+            cross curr_cross = cross_cache_best(cache, NULL, 0);
+            if(curr_cross.delta_cost >= -COST_EPS(inst)) break;
+
+            int ends[4] = { curr_cross.i, tour_next(t, curr_cross.i), curr_cross.j, tour_next(t, curr_cross.j) };
+            tour_flip(t, ends[1], ends[2]);
+            *cost+=curr_cross.delta_cost;
+            cross_cache_touch(cache, ends, 4, NULL, 0);
+
+            #if VERBOSE > 2
+                tour_get(t, tour);
+                check_tour_cost(inst, tour, *cost);
+            #endif
+        }
+
+        cross_cache_delete(cache);
+        tour_get(t, tour);
+        tour_delete(t);
+        return;
+    }
+
+    TSPtour* t = tour_new(tour, inst->nnodes, Array);
 
     while (REMAIN_TIME(init_time, env)) {
         cross curr_cross = find_best_cross(inst, tour);
-        if(curr_cross.delta_cost >= -EPSILON) return;
+        if(curr_cross.delta_cost >= -COST_EPS(inst)) break;
         
-        reverse(tour,curr_cross.i+1,curr_cross.j);
+        tour_flip(t, tour[curr_cross.i+1], tour[curr_cross.j]);
         *cost+=curr_cross.delta_cost;
             
         #if VERBOSE > 2
             check_tour_cost(inst, tour, *cost);
         #endif
     }
+
+    tour_delete(t);
+}
+
+
+/// @brief execute G2Opt on the candidate lists with don't-look bits: a queue holds the active
+///        nodes, every node is examined against its candidates only, and the endpoints of an
+///        applied move are queued again (best cross policy if the instance has no candidates)
+/// @param inst instance of TSPinst 
+/// @param tour hamiltionian circuit
+/// @param cost cost of path
+void TSPg2optnl(const TSPinst* inst, const TSPenv* env, double init_time, int* tour, double* cost) {
+    if(inst->cand == NULL) { TSPg2optb(inst, env, init_time, tour, cost); return; }
+
+    const unsigned int n = inst->nnodes;
+    TSPtour* t = tour_new(tour, n, TOUR_AUTO(n));
+    int* queue = (int*) malloc(n * sizeof(int));
+    char* active = (char*) malloc(n * sizeof(char));
+
+    for(int k = 0; k < n; k++) { queue[k] = tour[k]; active[tour[k]] = 1; }
+    unsigned int head = 0, size = n;
+
+    while (size && REMAIN_TIME(init_time, env)) {
+        int a = queue[head];
+        head = (head+1 == n) ? 0 : head+1;
+        size--;
+        active[a] = 0;
+
+        cross curr_cross = find_nl_cross(inst, t, a);
+        if(curr_cross.delta_cost >= -COST_EPS(inst)) continue;
+
+        int ends[4] = { curr_cross.i, tour_next(t, curr_cross.i), curr_cross.j, tour_next(t, curr_cross.j) };
+        tour_flip(t, ends[1], ends[2]);
+        *cost+=curr_cross.delta_cost;
+
+        for(int e = 0; e < 4; e++) {
+            if(active[ends[e]]) continue;
+            queue[(head + size) % n] = ends[e];
+            active[ends[e]] = 1;
+            size++;
+        }
+
+        #if VERBOSE > 2
+            tour_get(t, tour);
+            check_tour_cost(inst, tour, *cost);
+        #endif
+    }
+
+    tour_get(t, tour);
+    tour_delete(t);
+    free(queue);
+    free(active);
+}
+
+
+/// @brief execute Or-opt (segments of 1 to OROPT_MAX_LEN nodes moved next to a candidate of one of
+///        their ends) with don't-look bits: the nodes around an applied move are queued again
+/// @param inst instance of TSPinst (needs the candidate lists, otherwise the tour is left as is)
+/// @param tour hamiltionian circuit
+/// @param cost cost of path
+void TSPoropt(const TSPinst* inst, const TSPenv* env, double init_time, int* tour, double* cost) {
+    if(inst->cand == NULL) return;
+
+    const unsigned int n = inst->nnodes;
+    TSPtour* t = tour_new(tour, n, TOUR_AUTO(n));
+    int* queue = (int*) malloc(n * sizeof(int));
+    char* active = (char*) malloc(n * sizeof(char));
+
+    for(int k = 0; k < n; k++) { queue[k] = tour[k]; active[tour[k]] = 1; }
+    unsigned int head = 0, size = n;
+
+    while (size && REMAIN_TIME(init_time, env)) {
+        int a = queue[head];
+        head = (head+1 == n) ? 0 : head+1;
+        size--;
+        active[a] = 0;
+
+        oropt_move move = find_first_oropt(inst, t, a);
+        if(move.delta_cost >= -COST_EPS(inst)) continue;
+
+        int s2 = move.s;
+        for(int l = 1; l < move.len; l++) s2 = tour_next(t, s2);
+        int ends[6] = { tour_prev(t, move.s), move.s, s2, tour_next(t, s2), move.u, tour_next(t, move.u) };
+        apply_oropt(t, move);
+        *cost+=move.delta_cost;
+
+        for(int e = 0; e < 6; e++) {
+            if(active[ends[e]]) continue;
+            queue[(head + size) % n] = ends[e];
+            active[ends[e]] = 1;
+            size++;
+        }
+
+        #if VERBOSE > 2
+            tour_get(t, tour);
+            check_tour_cost(inst, tour, *cost);
+        #endif
+    }
+
+    tour_get(t, tour);
+    tour_delete(t);
+    free(queue);
+    free(active);
+}
+
+
+/// @brief execute Or-opt using best move policy (moves evaluated on the thread pool)
+/// @param inst instance of TSPinst (needs the candidate lists, otherwise the tour is left as is)
+/// @param tour hamiltionian circuit
+/// @param cost cost of path
+void TSPoroptb(const TSPinst* inst, const TSPenv* env, double init_time, int* tour, double* cost) {
+    if(inst->cand == NULL) return;
+
+    TSPtour* t = tour_new(tour, inst->nnodes, TOUR_AUTO(inst->nnodes));
+
+    while (REMAIN_TIME(init_time, env)) {
+        oropt_move move = find_best_oropt(inst, t);
+        if(move.delta_cost >= -COST_EPS(inst)) break;
+
+        apply_oropt(t, move);
+        *cost+=move.delta_cost;
+
+        #if VERBOSE > 2
+            tour_get(t, tour);
+            check_tour_cost(inst, tour, *cost);
+        #endif
+    }
+
+    tour_get(t, tour);
+    tour_delete(t);
+}
+
+
+/// @brief improvement function selected by the cli as local search of VNS and of the CPLEX warm start
+/// @param env instance of TSPenv
+/// @return TSPg2optb (G2OPT_B), TSPg2optnl (G2OPT_NL) or TSPlk (LK)
+opt_fun local_search_func(const TSPenv* env) {
+    char* best_func[] = {"G2OPT_B", "BEST"};
+    char* nl_func[] = {"G2OPT_NL", "NL"};
+    char* lk_func[] = {"LK", "LIN_KERNIGHAN"};
+
+    if(strnin(env->ls_method, nl_func, 2)) return TSPg2optnl;
+    if(strnin(env->ls_method, lk_func, 2)) return TSPlk;
+    if(!strnin(env->ls_method, best_func, 2)) print_state(Error, "Local search %s not implemented!\n", env->ls_method);
+    return TSPg2optb;
 }
 
 
@@ -175,23 +529,45 @@ TSPsol TSPtabu(TSPinst* inst, const TSPenv* env, const double init_time) {
     //int size_ratio = env->tabu_par;
     int size_ratio = BEST_TENURE;
     int tabu_size = inst->nnodes / size_ratio;
-    cross tabu[tabu_size];
+    cross* tabu = (cross*) malloc(tabu_size * sizeof(cross));
 
     double cost = inst->cost;
-    int tmp_sol[inst->nnodes];
+    int* tmp_sol = (int*) malloc(inst->nnodes * sizeof(int));
     memcpy(tmp_sol, inst->solution, inst->nnodes * sizeof(inst->solution[0]));
+    TSPtour* t = tour_new(tmp_sol, inst->nnodes, Array);
+    cross_cache* cache = (inst->cand != NULL) ? cross_cache_new(inst, t, tabu, 0) : NULL;
 
     while (REMAIN_TIME(init_time, env))
     {
-        cross move = find_best_t_cross(inst, tmp_sol, tabu, tabu_size);
-        reverse(tmp_sol, move.i + 1, move.j);
+        const int stored = (tabu_index < tabu_size) ? tabu_index : tabu_size;
+        cross move = { .delta_cost = INFINITY };
+        if(cache != NULL) {
+            // moves of nodes back to positions, as stored in tabu
+            cross node_move = cross_cache_best(cache, tabu, stored);
+            if(node_move.delta_cost < INFINITY) {
+                const int i = t->pos[node_move.i], j = t->pos[node_move.j];
+                move = (cross) { (i < j) ? i : j, (i < j) ? j : i, node_move.delta_cost };
+            }
+        }
+        if(move.delta_cost == INFINITY) move = find_best_t_cross(inst, tmp_sol, tabu, tabu_size);
+
+        // no admissible move (tiny instance, or every move is tabu)
+        if(move.delta_cost == INFINITY) break;
+
+        const int n = inst->nnodes;
+        const int x = tmp_sol[move.i];
+        int ends[4] = { x, tmp_sol[move.i + 1], tmp_sol[move.j], tmp_sol[(move.j + 1) % n] };
+        tour_flip(t, ends[1], ends[2]);
+        if(t->pos[x] != move.i) tabu_mirror(tabu, stored, move.i + move.j, n);
         cost += move.delta_cost;
 
-        if(move.delta_cost >= EPSILON) {
+        if(cache != NULL) cross_cache_touch(cache, ends, 4, tabu, stored);
+
+        if(move.delta_cost >= COST_EPS(inst)) {
             tabu[tabu_index % tabu_size] = move;
             tabu_index++;
         }
-        else if(cost < out.cost - EPSILON) {
+        else if(cost < out.cost - COST_EPS(inst)) {
             out.cost = cost;
             memcpy(out.tour, tmp_sol, inst->nnodes * sizeof(int));
 
@@ -204,11 +580,15 @@ TSPsol TSPtabu(TSPinst* inst, const TSPenv* env, const double init_time) {
         }
     }   
 
+    cross_cache_delete(cache);
+    tour_delete(t);
+    free(tabu);
+    free(tmp_sol);
     return out;
 }
 
 
-/// @brief execute VNS algorithm to improve TSP instance
+/// @brief execute VNS algorithm to improve TSP instance (local search chosen by local_search_func, then Or-opt)
 /// @param inst instance of TSPinst 
 /// @param env instance of TSPenv
 /// @param init_time initial time
@@ -217,16 +597,23 @@ TSPsol TSPvns(TSPinst* inst, const TSPenv* env, const double init_time) {
     TSPsol out = { .cost = inst->cost, .tour = malloc(inst->nnodes * sizeof(int)) };
 
     double cost = inst->cost;
-    int tmp_sol[inst->nnodes];
+    int* tmp_sol = (int*) malloc(inst->nnodes * sizeof(int));
     //if(env->vns_par<=0) print_state(Error,"not valid parameter!");
     
     memcpy(tmp_sol, inst->solution, inst->nnodes * sizeof(inst->solution[0]));
     int kick_size = 1;
+    opt_fun local_search = local_search_func(env);
 
     while (REMAIN_TIME(init_time, env)) {
-        TSPg2optb(inst, env, init_time, tmp_sol, &cost);
-
-        if(cost < out.cost - EPSILON) {
+        // VND: 2opt, then Or-opt on the 2opt local optimum, until neither improves
+        double vnd_cost;
+        do {
+            local_search(inst, env, init_time, tmp_sol, &cost);
+            vnd_cost = cost;
+            TSPoropt(inst, env, init_time, tmp_sol, &cost);
+        } while (cost < vnd_cost - COST_EPS(inst) && REMAIN_TIME(init_time, env));
+
+        if(cost < out.cost - COST_EPS(inst)) {
             out.cost = cost;
             memcpy(out.tour, tmp_sol, inst->nnodes * sizeof(int));
             kick_size = (kick_size <= 1) ? 1 : kick_size--;
@@ -243,5 +630,6 @@ TSPsol TSPvns(TSPinst* inst, const TSPenv* env, const double init_time) {
         #endif
     }
 
+    free(tmp_sol);
     return out;
 }
\ No newline at end of file
@@ -0,0 +1,525 @@
+#include "../include/tsp_spatial.h"
+
+#pragma region static_functions
+
+/// @brief partially sort perm[lo,hi) so that perm[k] holds the k-th smallest coordinate (quickselect)
+/// @param perm array of node indices
+/// @param key coordinate used as key
+/// @param lo first index
+/// @param hi last index (excluded)
+/// @param k target position
+static void kd_select(int* perm, const double* key, int lo, int hi, const int k) {
+    while(hi - lo > 1) {
+        double pivot = key[perm[lo + (hi - lo) / 2]];
+        int i = lo, j = hi - 1;
+        while(i <= j) {
+            while(key[perm[i]] < pivot) i++;
+            while(key[perm[j]] > pivot) j--;
+            if(i <= j) {
+                int tmp = perm[i]; perm[i] = perm[j]; perm[j] = tmp;
+                i++; j--;
+            }
+        }
+        if(k <= j) hi = j + 1;
+        else if(k >= i) lo = i;
+        else return;
+    }
+}
+
+
+/// @brief build the subtree over perm[lo,hi)
+/// @param tree instance of TSPkdtree
+/// @param lo first index inside perm
+/// @param hi last index inside perm (excluded)
+/// @param parent index of the parent node (-1 for the root)
+/// @return index of the new node
+static int kd_build(TSPkdtree* tree, const int lo, const int hi, const int parent) {
+    int id = tree->size++;
+    kd_node* node = &tree->nodes[id];
+    *node = (kd_node) { .lo = lo, .hi = hi, .left = -1, .right = -1, .parent = parent,
+                        .xmin = INFINITY, .xmax = -INFINITY, .ymin = INFINITY, .ymax = -INFINITY };
+
+    for(int k = lo; k < hi; k++) {
+        int p = tree->perm[k];
+        node->xmin = fmin(node->xmin, tree->x[p]); node->xmax = fmax(node->xmax, tree->x[p]);
+        node->ymin = fmin(node->ymin, tree->y[p]); node->ymax = fmax(node->ymax, tree->y[p]);
+    }
+
+    if(hi - lo <= KD_BUCKET) {
+        for(int k = lo; k < hi; k++) tree->leaf[tree->perm[k]] = id;
+        return id;
+    }
+
+    const double* key = (node->xmax - node->xmin >= node->ymax - node->ymin) ? tree->x : tree->y;
+    int mid = lo + (hi - lo) / 2;
+    kd_select(tree->perm, key, lo, hi, mid);
+
+    int left = kd_build(tree, lo, mid, id);
+    int right = kd_build(tree, mid, hi, id);
+    tree->nodes[id].left = left;
+    tree->nodes[id].right = right;
+    return id;
+}
+
+
+/// @brief squared distance between a point and the bounding box of a node
+static inline double kd_box_dist(const kd_node* node, const double x, const double y) {
+    double dx = (x < node->xmin) ? node->xmin - x : (x > node->xmax) ? x - node->xmax : 0;
+    double dy = (y < node->ymin) ? node->ymin - y : (y > node->ymax) ? y - node->ymax : 0;
+    return dx*dx + dy*dy;
+}
+
+
+/// @brief nearest alive node inside a subtree (ties broken by the smallest index)
+/// @param query instance of kd_query
+/// @param id subtree root
+/// @param x query x
+/// @param y query y
+/// @param best_dist squared distance of the best node found so far
+/// @param best index of the best node found so far
+static void kd_nearest(const kd_query* query, const int id, const double x, const double y, double* best_dist, int* best) {
+    const TSPkdtree* tree = query->tree;
+    const kd_node* node = &tree->nodes[id];
+
+    if(!query->alive[id] || kd_box_dist(node, x, y) > *best_dist) return;
+
+    if(node->left < 0) {
+        for(int k = node->lo; k < node->hi; k++) {
+            int p = tree->perm[k];
+            if(query->removed[p]) continue;
+
+            double dx = tree->x[p] - x;
+            double dy = tree->y[p] - y;
+            double d = dx*dx + dy*dy;
+            if(d < *best_dist || (d == *best_dist && p < *best)) { *best_dist = d; *best = p; }
+        }
+        return;
+    }
+
+    int first = node->left, second = node->right;
+    if(kd_box_dist(&tree->nodes[second], x, y) < kd_box_dist(&tree->nodes[first], x, y)) { first = node->right; second = node->left; }
+
+    kd_nearest(query, first, x, y, best_dist, best);
+    kd_nearest(query, second, x, y, best_dist, best);
+}
+
+/// @brief true if neighbor a comes after neighbor b (distance, then index)
+static inline char kd_after(const kd_neighbor a, const kd_neighbor b) {
+    return a.dist > b.dist || (a.dist == b.dist && a.index > b.index);
+}
+
+
+/// @brief push a neighbor into a bounded max-heap (root = farthest kept)
+/// @param heap heap array
+/// @param size current size
+/// @param k capacity
+/// @param nb new neighbor
+static void kd_heap_push(kd_neighbor* heap, int* size, const unsigned int k, const kd_neighbor nb) {
+    int c;
+    if(*size < (int) k) c = (*size)++;
+    else if(kd_after(heap[0], nb)) {
+        // replace the root and sift down
+        int p = 0;
+        for(;;) {
+            int l = 2*p + 1, r = l + 1, m = p;
+            kd_neighbor cur = (m == p) ? nb : heap[m];
+            if(l < *size && kd_after(heap[l], cur)) { m = l; cur = heap[l]; }
+            if(r < *size && kd_after(heap[r], cur)) { m = r; }
+            if(m == p) break;
+            heap[p] = heap[m];
+            p = m;
+        }
+        heap[p] = nb;
+        return;
+    }
+    else return;
+
+    while(c > 0 && kd_after(nb, heap[(c - 1) / 2])) {
+        heap[c] = heap[(c - 1) / 2];
+        c = (c - 1) / 2;
+    }
+    heap[c] = nb;
+}
+
+
+/// @brief true if the offset (dx,dy) lies inside a quadrant (the four quadrants partition the plane)
+static inline char kd_in_quad(const double dx, const double dy, const int quad) {
+    switch (quad) {
+        case 0:  return (dx > 0 && dy >= 0) || (dx == 0 && dy == 0);
+        case 1:  return dx <= 0 && dy > 0;
+        case 2:  return dx < 0 && dy <= 0;
+        case 3:  return dx >= 0 && dy < 0;
+        default: return 1;
+    }
+}
+
+
+/// @brief true if the bounding box of a node may contain points of a quadrant around (x,y)
+static inline char kd_box_in_quad(const kd_node* node, const double x, const double y, const int quad) {
+    switch (quad) {
+        case 0:  return node->xmax >= x && node->ymax >= y;
+        case 1:  return node->xmin <= x && node->ymax >= y;
+        case 2:  return node->xmin <= x && node->ymin <= y;
+        case 3:  return node->xmax >= x && node->ymin <= y;
+        default: return 1;
+    }
+}
+
+
+/// @brief k nearest nodes inside a subtree
+/// @param tree instance of TSPkdtree
+/// @param id subtree root
+/// @param i reference node (excluded)
+/// @param quad quadrant around i the neighbors must lie in (-1 for the whole plane)
+/// @param k number of neighbors
+/// @param heap bounded max-heap of the best neighbors found so far
+/// @param size current heap size
+static void kd_knn(const TSPkdtree* tree, const int id, const int i, const int quad, const unsigned int k, kd_neighbor* heap, int* size) {
+    const kd_node* node = &tree->nodes[id];
+    const double x = tree->x[i], y = tree->y[i];
+
+    if(!kd_box_in_quad(node, x, y, quad)) return;
+    if(*size == (int) k && kd_box_dist(node, x, y) > heap[0].dist) return;
+
+    if(node->left < 0) {
+        for(int q = node->lo; q < node->hi; q++) {
+            int p = tree->perm[q];
+            if(p == i) continue;
+
+            double dx = tree->x[p] - x;
+            double dy = tree->y[p] - y;
+            if(!kd_in_quad(dx, dy, quad)) continue;
+            kd_heap_push(heap, size, k, (kd_neighbor) { .dist = dx*dx + dy*dy, .index = p });
+        }
+        return;
+    }
+
+    int first = node->left, second = node->right;
+    if(kd_box_dist(&tree->nodes[second], x, y) < kd_box_dist(&tree->nodes[first], x, y)) { first = node->right; second = node->left; }
+
+    kd_knn(tree, first, i, quad, k, heap, size);
+    kd_knn(tree, second, i, quad, k, heap, size);
+}
+
+
+static int neighbor_ascending(const void* elem1, const void* elem2) {
+    kd_neighbor f = *(kd_neighbor*) elem1;
+    kd_neighbor s = *(kd_neighbor*) elem2;
+    return kd_after(f, s) - kd_after(s, f);
+}
+
+
+/// @brief worker: claim nodes and fill their candidate list
+/// @param userhandle pointer to mt_cand_pars
+static void* cand_job(void* userhandle) {
+    mt_cand_pars* pars = (mt_cand_pars*) userhandle;
+    const TSPinst* inst = pars->mt_inst;
+    kd_neighbor* heap = (kd_neighbor*) malloc(pars->mt_k * sizeof(kd_neighbor));
+
+    unsigned int start;
+    while((start = __atomic_fetch_add(&pars->mt_next_node, DIST_ROW_BLOCK, __ATOMIC_RELAXED)) < inst->nnodes) {
+        unsigned int end = (start + DIST_ROW_BLOCK < inst->nnodes) ? start + DIST_ROW_BLOCK : inst->nnodes;
+
+        for(unsigned int i = start; i < end; i++) {
+            if(inst->kdtree != NULL) kdtree_knn(inst->kdtree, i, pars->mt_k, heap);
+            else {
+                // no planar geometry (GEO, EXPLICIT): scan the whole row
+                int size = 0;
+                for(unsigned int j = 0; j < inst->nnodes; j++)
+                    if(j != i) kd_heap_push(heap, &size, pars->mt_k, (kd_neighbor) { .dist = get_arc(inst, i, j), .index = j });
+                qsort(heap, size, sizeof(kd_neighbor), neighbor_ascending);
+            }
+            for(unsigned int h = 0; h < pars->mt_k; h++) pars->mt_cand[(size_t) i * pars->mt_k + h] = heap[h].index;
+        }
+    }
+
+    free(heap);
+    return NULL;
+}
+
+
+/// @brief worker: claim nodes and collect their quadrant neighbors as arcs (i,j)
+/// @param userhandle pointer to mt_graph_pars
+static void* graph_job(void* userhandle) {
+    mt_graph_pars* pars = (mt_graph_pars*) userhandle;
+    const TSPinst* inst = pars->mt_inst;
+    const unsigned int slots = 4 * pars->mt_quad;
+    kd_neighbor* heap = (kd_neighbor*) malloc(pars->mt_quad * sizeof(kd_neighbor));
+
+    unsigned int start;
+    while((start = __atomic_fetch_add(&pars->mt_next_node, DIST_ROW_BLOCK, __ATOMIC_RELAXED)) < inst->nnodes) {
+        unsigned int end = (start + DIST_ROW_BLOCK < inst->nnodes) ? start + DIST_ROW_BLOCK : inst->nnodes;
+
+        for(unsigned int i = start; i < end; i++) {
+            uint64_t* arcs = &pars->mt_arcs[(size_t) i * slots];
+            unsigned int h = 0;
+
+            for(int quad = 0; quad < 4; quad++) {
+                int size = 0;
+                kd_knn(inst->kdtree, 0, i, quad, pars->mt_quad, heap, &size);
+                for(int s = 0; s < size; s++) {
+                    uint64_t lo = (i < heap[s].index) ? i : heap[s].index;
+                    uint64_t hi = (i < heap[s].index) ? heap[s].index : i;
+                    arcs[h++] = (lo << 32) | hi;
+                }
+            }
+            // unused slots sort after every real edge and are dropped
+            for(; h < slots; h++) arcs[h] = UINT64_MAX;
+        }
+    }
+
+    free(heap);
+    return NULL;
+}
+
+
+static int edge_ascending(const void* elem1, const void* elem2) {
+    uint64_t f = *(uint64_t*) elem1;
+    uint64_t s = *(uint64_t*) elem2;
+    return (f > s) - (f < s);
+}
+
+#pragma endregion
+
+
+/// @brief build a 2d k-d tree over the points of an instance
+/// @param inst instance of TSPinst (SoA coordinates already loaded)
+/// @return an instance of TSPkdtree
+TSPkdtree* kdtree_new(const TSPinst* inst) {
+    TSPkdtree* tree = (TSPkdtree*) calloc(1, sizeof(TSPkdtree));
+    tree->nnodes = inst->nnodes;
+    tree->x = inst->xcoord;
+    tree->y = inst->ycoord;
+
+    tree->perm = (int*) malloc(inst->nnodes * sizeof(int));
+    tree->leaf = (int*) malloc(inst->nnodes * sizeof(int));
+    // every leaf keeps at least KD_BUCKET/2 points
+    tree->nodes = (kd_node*) malloc((2 * (inst->nnodes / (KD_BUCKET / 2)) + 2) * sizeof(kd_node));
+    if(tree->perm == NULL || tree->leaf == NULL || tree->nodes == NULL) print_state(Error, " failed to allocate memory for k-d tree!");
+
+    for(int i = 0; i < inst->nnodes; i++) tree->perm[i] = i;
+    kd_build(tree, 0, inst->nnodes, -1);
+
+    return tree;
+}
+
+
+/// @brief free memory of an instance of TSPkdtree
+/// @param tree instance of TSPkdtree
+void kdtree_delete(TSPkdtree* tree) {
+    if(tree == NULL) return;
+    free(tree->perm);
+    free(tree->leaf);
+    free(tree->nodes);
+    free(tree);
+}
+
+
+/// @brief start a sequence of queries on a k-d tree, with every node alive
+/// @param tree instance of TSPkdtree
+/// @return an instance of kd_query (each thread needs its own)
+kd_query* kdquery_new(const TSPkdtree* tree) {
+    kd_query* query = (kd_query*) malloc(sizeof(kd_query));
+    query->tree = tree;
+    query->alive = (int*) malloc(tree->size * sizeof(int));
+    query->removed = (char*) calloc(tree->nnodes, sizeof(char));
+
+    for(int id = 0; id < tree->size; id++) query->alive[id] = tree->nodes[id].hi - tree->nodes[id].lo;
+    return query;
+}
+
+
+/// @brief free memory of an instance of kd_query
+/// @param query instance of kd_query
+void kdquery_delete(kd_query* query) {
+    free(query->alive);
+    free(query->removed);
+    free(query);
+}
+
+
+/// @brief remove a node from the following queries
+/// @param query instance of kd_query
+/// @param i node to remove
+void kdquery_remove(kd_query* query, const int i) {
+    if(query->removed[i]) return;
+    query->removed[i] = 1;
+    for(int id = query->tree->leaf[i]; id >= 0; id = query->tree->nodes[id].parent) query->alive[id]--;
+}
+
+
+/// @brief nearest alive node to a given node
+/// @param query instance of kd_query
+/// @param i reference node (not returned even if alive)
+/// @param sqdist if not NULL, squared euclidian distance of the result
+/// @return nearest alive node, -1 if none is left
+int kdquery_nearest(const kd_query* query, const int i, double* sqdist) {
+    double best_dist = INFINITY;
+    int best = -1;
+
+    char was_removed = query->removed[i];
+    query->removed[i] = 1;
+    kd_nearest(query, 0, query->tree->x[i], query->tree->y[i], &best_dist, &best);
+    query->removed[i] = was_removed;
+
+    if(sqdist != NULL) *sqdist = best_dist;
+    return best;
+}
+
+
+/// @brief k nearest nodes of a node, sorted by distance
+/// @param tree instance of TSPkdtree
+/// @param i reference node
+/// @param k number of neighbors (< number of nodes)
+/// @param out destination (k entries: index and squared euclidian distance)
+/// @return number of neighbors found
+int kdtree_knn(const TSPkdtree* tree, const int i, const unsigned int k, kd_neighbor* out) {
+    int size = 0;
+    kd_knn(tree, 0, i, -1, k, out, &size);
+    qsort(out, size, sizeof(kd_neighbor), neighbor_ascending);
+    return size;
+}
+
+
+/// @brief build the candidate lists: the k nearest neighbors of every node, sorted by distance
+/// @param inst instance of TSPinst (k-d tree already built, if the metric is planar)
+/// @param k candidates per node (clamped to nnodes-1)
+/// @return flat cache-aligned array, neighbors of node i in [i*k, (i+1)*k)
+int* cand_new(const TSPinst* inst, const unsigned int k) {
+    size_t bytes = (size_t) inst->nnodes * k * sizeof(int);
+    bytes = (bytes + CAND_ALIGN - 1) / CAND_ALIGN * CAND_ALIGN;
+
+    int* cand = (int*) aligned_alloc(CAND_ALIGN, bytes);
+    if(cand == NULL) print_state(Error, " failed to allocate memory for candidate lists!");
+
+    int num_threads = mt_pool_size();
+
+    mt_cand_pars cand_par = {   .mt_inst = inst,
+                                .mt_cand = cand,
+                                .mt_k = k,
+                                .mt_next_node = 0 };
+
+    mt_context* cand_ctx = new_mt_context(num_threads, !HANDLE_MTX);
+    run_job(cand_ctx, cand_job, &cand_par);
+    delete_mt_context(cand_ctx, !HANDLE_MTX);
+
+    #if VERBOSE > 1
+        print_state(Info, "Candidate lists (%u neighbors per node) built on %d threads\n", k, num_threads);
+    #endif
+
+    return cand;
+}
+
+
+/// @brief build the quadrant-neighbor candidate graph: every node is linked to its q nearest
+///        nodes in each of the four quadrants around it (O(n) edges, O(n log n) time)
+/// @param inst instance of TSPinst (k-d tree already built)
+/// @param q neighbors per quadrant
+/// @return an instance of TSPgraph (undirected, CSR)
+TSPgraph* graph_new(const TSPinst* inst, const unsigned int q) {
+    if(inst->kdtree == NULL) { print_state(Warn, "candidate graph needs planar coordinates, not built\n"); return NULL; }
+
+    const unsigned int n = inst->nnodes;
+    const size_t slots = (size_t) n * 4 * q;
+
+    uint64_t* arcs = (uint64_t*) malloc(slots * sizeof(uint64_t));
+    if(arcs == NULL) print_state(Error, " failed to allocate memory for candidate graph!");
+
+    int num_threads = mt_pool_size();
+
+    mt_graph_pars graph_par = { .mt_inst = inst,
+                                .mt_arcs = arcs,
+                                .mt_quad = q,
+                                .mt_next_node = 0 };
+
+    mt_context* graph_ctx = new_mt_context(num_threads, !HANDLE_MTX);
+    run_job(graph_ctx, graph_job, &graph_par);
+    delete_mt_context(graph_ctx, !HANDLE_MTX);
+
+    // symmetrize: sort the (lo,hi) keys and drop duplicates
+    qsort(arcs, slots, sizeof(uint64_t), edge_ascending);
+    size_t m = 0;
+    for(size_t e = 0; e < slots && arcs[e] != UINT64_MAX; e++)
+        if(m == 0 || arcs[e] != arcs[m-1]) arcs[m++] = arcs[e];
+
+    TSPgraph* graph = (TSPgraph*) calloc(1, sizeof(TSPgraph));
+    graph->nnodes = n;
+    graph->nedges = m;
+    graph->start = (size_t*) calloc(n + 1, sizeof(size_t));
+    graph->adj = (int*) malloc(2 * m * sizeof(int));
+    graph->edge_u = (int*) malloc(m * sizeof(int));
+    graph->edge_v = (int*) malloc(m * sizeof(int));
+    if(graph->start == NULL || graph->adj == NULL || graph->edge_u == NULL || graph->edge_v == NULL) print_state(Error, " failed to allocate memory for candidate graph!");
+
+    for(size_t e = 0; e < m; e++) {
+        graph->edge_u[e] = (int) (arcs[e] >> 32);
+        graph->edge_v[e] = (int) (arcs[e] & UINT32_MAX);
+        graph->start[graph->edge_u[e] + 1]++;
+        graph->start[graph->edge_v[e] + 1]++;
+    }
+    free(arcs);
+
+    for(unsigned int i = 0; i < n; i++) graph->start[i + 1] += graph->start[i];
+
+    // edges are sorted by (u,v): each adjacency list is filled in ascending order
+    size_t* pos = (size_t*) malloc(n * sizeof(size_t));
+    memcpy(pos, graph->start, n * sizeof(size_t));
+    for(size_t e = 0; e < m; e++) {
+        graph->adj[pos[graph->edge_u[e]]++] = graph->edge_v[e];
+        graph->adj[pos[graph->edge_v[e]]++] = graph->edge_u[e];
+    }
+    free(pos);
+
+    #if VERBOSE > 1
+        print_state(Info, "Quadrant candidate graph: %zu edges (%.2f per node)\n", m, 2.0 * m / n);
+    #endif
+
+    return graph;
+}
+
+
+/// @brief free memory of an instance of TSPgraph
+/// @param graph instance of TSPgraph
+void graph_delete(TSPgraph* graph) {
+    if(graph == NULL) return;
+    free(graph->start);
+    free(graph->adj);
+    free(graph->edge_u);
+    free(graph->edge_v);
+    free(graph->extra);
+    free(graph);
+}
+
+
+/// @brief check if the edge (i,j) belongs to the candidate graph
+/// @param graph instance of TSPgraph
+/// @param i node of index i
+/// @param j node of index j
+/// @return 1 if the edge is a candidate, 0 otherwise
+char graph_has_edge(const TSPgraph* graph, const int i, const int j) {
+    size_t lo = graph->start[i], hi = graph->start[i + 1];
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(graph->adj[mid] < j) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < graph->start[i + 1] && graph->adj[lo] == j;
+}
+
+
+/// @brief position of the edge (i,j) in the sorted edge list (edge_u, edge_v)
+/// @param graph instance of TSPgraph
+/// @param i node of index i
+/// @param j node of index j
+/// @return index of the edge, graph->nedges if it is not a candidate
+size_t graph_edge_index(const TSPgraph* graph, const int i, const int j) {
+    if(i > j) return graph_edge_index(graph, j, i);
+
+    size_t lo = 0, hi = graph->nedges;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(graph->edge_u[mid] < i || (graph->edge_u[mid] == i && graph->edge_v[mid] < j)) lo = mid + 1;
+        else hi = mid;
+    }
+    return (lo < graph->nedges && graph->edge_u[lo] == i && graph->edge_v[lo] == j) ? lo : graph->nedges;
+}
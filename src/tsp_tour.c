@@ -0,0 +1,220 @@
+#include "../include/tsp_tour.h"
+
+#pragma region static_functions
+
+/// @brief lay the sequence out in the storage: segments of about sqrt(n) nodes, in order, not reversed
+/// @param t instance of TSPtour (TwoLevel)
+/// @param seq tour sequence (must not alias t->order)
+static void tour_layout(TSPtour* t, const int* seq) {
+    const unsigned int n = t->nnodes;
+    const unsigned int group = (unsigned int) ceil(sqrt(n));
+
+    for(int k = 0; k < n; k++) { t->order[k] = seq[k]; t->pos[seq[k]] = k; }
+
+    t->nseg = (n + group - 1) / group;
+    for(int s = 0; s < t->nseg; s++) {
+        t->seg[s] = (tour_seg) { .lo = s * group, .hi = ((s+1) * group < n) ? (s+1) * group : n, .rank = s, .reversed = 0 };
+        t->seg_order[s] = s;
+        for(int k = t->seg[s].lo; k < t->seg[s].hi; k++) t->node_seg[t->order[k]] = s;
+    }
+}
+
+
+/// @brief position of a node along the tour, as an increasing key (segment rank, offset inside it)
+static inline size_t tour_key(const TSPtour* t, const int a) {
+    if(t->type == Array) return t->pos[a];
+
+    const tour_seg* s = &t->seg[t->node_seg[a]];
+    const int off = s->reversed ? s->hi - 1 - t->pos[a] : t->pos[a] - s->lo;
+    return (size_t) s->rank * t->nnodes + off;
+}
+
+
+/// @brief swap the storage of two nodes (same segment)
+static inline void tour_swap(TSPtour* t, const int k1, const int k2) {
+    int tmp = t->order[k1];
+    t->order[k1] = t->order[k2];
+    t->order[k2] = tmp;
+    t->pos[t->order[k1]] = k1;
+    t->pos[t->order[k2]] = k2;
+}
+
+
+/// @brief reverse the positions i..j of a circular array, or the complementary ones if shorter
+static void array_flip(TSPtour* t, const int i, const int j) {
+    const int n = t->nnodes;
+    int from = i, to = j;
+    int len = (to - from + n) % n + 1;
+
+    if(2 * len > n) { from = (j+1 == n) ? 0 : j+1; to = (i == 0) ? n-1 : i-1; len = n - len; }
+
+    for(int k = 0; k < len / 2; k++) {
+        tour_swap(t, from, to);
+        from = (from+1 == n) ? 0 : from+1;
+        to = (to == 0) ? n-1 : to-1;
+    }
+}
+
+
+/// @brief make a the first node (in the tour direction) of its segment: the smaller part of the
+///        segment becomes a new one, so only its nodes are relabelled
+static void tour_split(TSPtour* t, const int a) {
+    const int s = t->node_seg[a];
+    tour_seg old = t->seg[s];
+    const int k = t->pos[a];
+    if(k == (old.reversed ? old.hi - 1 : old.lo)) return;
+
+    // storage slices of the part before a and of the part from a on (tour direction)
+    int blo = old.reversed ? k+1 : old.lo, bhi = old.reversed ? old.hi : k;
+    int alo = old.reversed ? old.lo : k,   ahi = old.reversed ? k+1 : old.hi;
+    const char small_before = (bhi - blo) < (ahi - alo);
+
+    const int ns = t->nseg++;
+    const int rank = small_before ? old.rank : old.rank + 1;
+    t->seg[s].lo = small_before ? alo : blo;
+    t->seg[s].hi = small_before ? ahi : bhi;
+    t->seg[ns] = (tour_seg) { .lo = small_before ? blo : alo, .hi = small_before ? bhi : ahi, .rank = rank, .reversed = old.reversed };
+
+    for(int r = t->nseg-1; r > rank; r--) { t->seg_order[r] = t->seg_order[r-1]; t->seg[t->seg_order[r]].rank = r; }
+    t->seg_order[rank] = ns;
+    for(int q = t->seg[ns].lo; q < t->seg[ns].hi; q++) t->node_seg[t->order[q]] = ns;
+}
+
+
+/// @brief reverse m segments of the order from rank r (cyclic), toggling their direction
+static void tour_flip_segments(TSPtour* t, int r, const int m) {
+    for(int h = 0, k = r; h < m; h++, k = (k+1 == t->nseg) ? 0 : k+1) t->seg[t->seg_order[k]].reversed ^= 1;
+
+    int q = (r + m - 1) % t->nseg;
+    for(int h = 0; h < m / 2; h++) {
+        int tmp = t->seg_order[r];
+        t->seg_order[r] = t->seg_order[q];
+        t->seg_order[q] = tmp;
+        t->seg[t->seg_order[r]].rank = r;
+        t->seg[t->seg_order[q]].rank = q;
+        r = (r+1 == t->nseg) ? 0 : r+1;
+        q = (q == 0) ? t->nseg-1 : q-1;
+    }
+}
+
+#pragma endregion
+
+
+/// @brief tour with next/prev/between/flip in any direction: Array keeps the sequence (the
+///        caller's array, updated in place) and the position of every node; TwoLevel splits it
+///        in about sqrt(n) segments with a reversed bit, so a flip costs O(sqrt(n))
+/// @param order tour sequence (Array: used as storage, TwoLevel: copied)
+/// @param nnodes number of nodes
+/// @param type Array or TwoLevel (TOUR_AUTO picks by size)
+/// @return an instance of TSPtour
+TSPtour* tour_new(int* order, const unsigned int nnodes, const int type) {
+    TSPtour* t = (TSPtour*) calloc(1, sizeof(TSPtour));
+    t->type = type;
+    t->nnodes = nnodes;
+    t->pos = (int*) malloc(nnodes * sizeof(int));
+
+    if(type == Array) {
+        t->order = order;
+        for(int k = 0; k < nnodes; k++) t->pos[order[k]] = k;
+        return t;
+    }
+
+    const unsigned int group = (unsigned int) ceil(sqrt(nnodes));
+    t->maxseg = TOUR_SEG_SLACK * ((nnodes + group - 1) / group) + 2;
+    t->order = (int*) malloc(nnodes * sizeof(int));
+    t->seg = (tour_seg*) malloc(t->maxseg * sizeof(tour_seg));
+    t->seg_order = (int*) malloc(t->maxseg * sizeof(int));
+    t->node_seg = (int*) malloc(nnodes * sizeof(int));
+    t->buffer = (int*) malloc(nnodes * sizeof(int));
+    tour_layout(t, order);
+    return t;
+}
+
+
+/// @brief free memory of an instance of TSPtour (the caller's array of an Array tour is kept)
+/// @param t instance of TSPtour
+void tour_delete(TSPtour* t) {
+    if(t == NULL) return;
+    if(t->type != Array) {
+        free(t->order);
+        free(t->seg);
+        free(t->seg_order);
+        free(t->node_seg);
+        free(t->buffer);
+    }
+    free(t->pos);
+    free(t);
+}
+
+
+/// @brief write the tour sequence
+/// @param t instance of TSPtour
+/// @param out destination array (nnodes entries)
+void tour_get(const TSPtour* t, int* out) {
+    if(t->type == Array) {
+        if(out != t->order) memcpy(out, t->order, t->nnodes * sizeof(int));
+        return;
+    }
+
+    int k = 0;
+    for(int r = 0; r < t->nseg; r++) {
+        const tour_seg* s = &t->seg[t->seg_order[r]];
+        if(s->reversed) for(int q = s->hi-1; q >= s->lo; q--) out[k++] = t->order[q];
+        else for(int q = s->lo; q < s->hi; q++) out[k++] = t->order[q];
+    }
+}
+
+
+/// @brief true if b lies on the path from a to c in the current direction
+/// @param t instance of TSPtour
+char tour_between(const TSPtour* t, const int a, const int b, const int c) {
+    const size_t ka = tour_key(t, a), kb = tour_key(t, b), kc = tour_key(t, c);
+    if(ka <= kc) return ka <= kb && kb <= kc;
+    return kb >= ka || kb <= kc;
+}
+
+
+/// @brief reverse the path from b to c (current direction), or the rest of the tour if shorter:
+///        the resulting cycle is the same, the direction of the tour may change
+/// @param t instance of TSPtour
+/// @param b first node of the path
+/// @param c last node of the path
+void tour_flip(TSPtour* t, const int b, const int c) {
+    if(b == c) return;
+    if(t->type == Array) { array_flip(t, t->pos[b], t->pos[c]); return; }
+
+    // path inside one segment: reverse its storage
+    const int sb = t->node_seg[b];
+    if(sb == t->node_seg[c] && tour_key(t, b) <= tour_key(t, c)) {
+        int lo = t->pos[b], hi = t->pos[c];
+        if(lo > hi) { int tmp = lo; lo = hi; hi = tmp; }
+        while(lo < hi) tour_swap(t, lo++, hi--);
+        return;
+    }
+
+    const int cn = tour_next(t, c);
+    if(cn == b) return;
+
+    if(t->nseg + 2 > t->maxseg) {
+        tour_get(t, t->buffer);
+        tour_layout(t, t->buffer);
+    }
+    tour_split(t, b);
+    tour_split(t, cn);
+
+    const int rb = t->seg[t->node_seg[b]].rank, rc = t->seg[t->node_seg[c]].rank;
+    const int m = (rc - rb + t->nseg) % t->nseg + 1;
+    if(2 * m <= t->nseg) tour_flip_segments(t, rb, m);
+    else if(m < t->nseg) tour_flip_segments(t, (rc+1) % t->nseg, t->nseg - m);
+}
+
+
+/// @brief reverse the path between nodes a and b whatever the current direction of the tour
+/// @param t instance of TSPtour
+/// @param a first node of the path
+/// @param b last node of the path
+/// @param o node next to a outside the path
+void tour_flip_path(TSPtour* t, const int a, const int b, const int o) {
+    if(tour_prev(t, a) == o) tour_flip(t, a, b);
+    else tour_flip(t, b, a);
+}
@@ -1,7 +1,5 @@
 #include "../include/tsp_utils.h"
 
-static pthread_mutex_t G2OPT_MTX;
-
 #define SQUARE(x)       (x*x)
 /// @brief compute euclidian distance for 2d points
 /// @param a instance of point
@@ -15,6 +13,20 @@ double euc_2d(const point a, const point b) {
 }
 
 
+/// @brief compute the delta cost between 2 arc switch on integer costs (exact)
+/// @param inst instance of TSPinst (Int32 distances)
+/// @param i node i
+/// @param in next of i
+/// @param j node j
+/// @param jn next of j
+/// @return result of (c_ij + c_injn) - (c_iin + c_jjn)
+static inline int64_t delta_icost(const TSPinst* inst, const unsigned int i, const unsigned int in, const unsigned int j, const unsigned int jn) {
+
+    return  ((int64_t) get_iarc(inst, i, j) + get_iarc(inst, in, jn)) - 
+            ((int64_t) get_iarc(inst, i, in) + get_iarc(inst, j, jn));
+}
+
+
 /// @brief compute the delta cost between 2 arc switch
 /// @param inst instance of TSPinst
 /// @param i node i
@@ -23,28 +35,13 @@ double euc_2d(const point a, const point b) {
 /// @param jn next of j
 /// @return result of (c_ij + c_injn) - (c_iin + c_jjn)
 inline double delta_cost(const TSPinst* inst, const unsigned int i, const unsigned int in, const unsigned int j, const unsigned int jn) {
+    if(inst->dist->type == Int32) return (double) delta_icost(inst, i, in, j, jn);
 
     return  (get_arc(inst, i, j) + get_arc(inst, in, jn)) - 
             (get_arc(inst, i, in) + get_arc(inst, j, jn));
 }
 
 
-/// @brief get distance of the arc i->j
-/// @param inst instance of TSPinst
-/// @param i node of index i
-/// @param j node of index j
-/// @return euclidian distance between i and j
-double get_arc(const TSPinst* inst, const unsigned int i, const unsigned int j) {
-    if(edge_weights == NULL) perror("EDGE WEIGHT not initialized");
-    if (i == j) return 0.0;
-    int q = coords_to_index(inst->nnodes, i, j);
-    if(!edge_weights[q]) {
-        edge_weights[q] = euc_2d(inst->points[i], inst->points[j]);
-    } 
-    return edge_weights[q];
-}
-
-
 /// @brief DEBUGGING function: check if expected cost is equal to real cost recompute
 /// @param inst instance of TSPinst 
 /// @param tour hamiltonian circuit
@@ -69,6 +66,12 @@ void check_tour_cost(const TSPinst* inst, const int* tour, const double expected
 double compute_cost(TSPinst* inst,const int* tmp_sol) {
     if(tmp_sol == NULL) tmp_sol=inst->solution;
 
+    if(inst->dist->type == Int32) {
+        int64_t out_icost = get_iarc(inst, tmp_sol[0], tmp_sol[inst->nnodes-1]);
+        for(int i = 0; i < inst->nnodes-1; i++) out_icost += get_iarc(inst, tmp_sol[i], tmp_sol[i+1]);
+        return (double) out_icost;
+    }
+
     double out_cost = 0;
     
     for(int i = 0; i < inst->nnodes-1; i++) {
@@ -80,19 +83,64 @@ double compute_cost(TSPinst* inst,const int* tmp_sol) {
 }
 
 
-/// @brief get the nearest available neighbor form an index 
-/// @param inst instance of TSPinst
-/// @param index starting node
-/// @param res list of already viewed points
-/// @return return point and distance
-near_neighbor get_nearest_neighbor(const TSPinst* inst, const unsigned int index, const char* res) {
+#pragma region kernel_instances
+
+/// @brief first improving 2opt move with i in [from,to), inlined on one distance kernel
+DIST_INLINE cross first_cross_scan(const TSPinst* inst, const int* tour, const int from, const int to, const arc_fun arc) {
+    const TSPdist* dist = inst->dist;
+    const int n = inst->nnodes;
+    const double eps = COST_EPS(inst);
+
+    for(int i=from; i< to; i++) {
+        const int a = tour[i], an = tour[i+1];
+        const double c_a = arc(dist, a, an);
+
+        for(int j=i+2; j<n; j++) {
+            if (i==0 && j+1==n) continue;
+
+            const int b = tour[j], bn = tour[(j+1 == n) ? 0 : j+1];
+            double delta_cost = (arc(dist, a, b) + arc(dist, an, bn)) - (c_a + arc(dist, b, bn));
+            if(delta_cost < -eps) return (cross){i,j,delta_cost};
+        }
+    }
+    return (cross){-1,-1,EPSILON};
+}
+
+
+/// @brief best 2opt move with i in [from,to) not in tabu, inlined on one distance kernel
+DIST_INLINE cross best_cross_scan(const TSPinst* inst, const int* tour, const int from, const int to, const cross* tabu, const int tabu_size, const arc_fun arc) {
+    const TSPdist* dist = inst->dist;
+    const int n = inst->nnodes;
+    const double eps = COST_EPS(inst);
+    cross best = {-1,-1,INFINITY};
+
+    for(int i = from; i < to; i++){
+        const int a = tour[i], an = tour[i+1];
+        const double c_a = arc(dist, a, an);
+
+        for(int j=i+2;j<n;j++){
+            if(i==0 && j+1==n) continue;
+
+            const int b = tour[j], bn = tour[(j+1 == n) ? 0 : j+1];
+            double delta_cost = (arc(dist, a, b) + arc(dist, an, bn)) - (c_a + arc(dist, b, bn));
+
+            if(delta_cost < best.delta_cost + eps && (tabu == NULL || !is_in_tabu(i, j, tabu, tabu_size)))
+                best = (cross){.i=i,.j=j,.delta_cost=delta_cost};
+        }
+    }
+    return best;
+}
+
+
+/// @brief nearest node not in res, inlined on one distance kernel
+DIST_INLINE near_neighbor nearest_scan(const TSPinst* inst, const unsigned int index, const char* res, const arc_fun arc) {
     near_neighbor out = { .dist = INFINITY, .index = 0};
 
     for(int i = 0; i < inst->nnodes; i++) {
         if(res[i] != 0 || i == index) continue;
-        
-        double dist = get_arc(inst,index,i);
-        if (dist < out.dist && dist != 0) {
+
+        double dist = arc(inst->dist, index, i);
+        if (dist < out.dist) {
             out = (near_neighbor) {.dist = dist, .index = i};
         }
     }
@@ -100,6 +148,440 @@ near_neighbor get_nearest_neighbor(const TSPinst* inst, const unsigned int index
 }
 
 
+/// @brief delta cost of a 3opt kick on the positions t[0] < t[1] < t[2], inlined on one distance kernel
+DIST_INLINE double kick_scan(const TSPinst* inst, const int* tour, const int* t, const int k2, const int move, const arc_fun arc) {
+    const TSPdist* dist = inst->dist;
+    double delta_cost = - ( arc(dist, tour[t[0]], tour[t[0] + 1]) +
+                            arc(dist, tour[t[1]], tour[t[1] + 1]) +
+                            arc(dist, tour[t[2]], k2));
+
+    switch(move) {
+        case 0:  return delta_cost + (arc(dist, tour[t[0]], tour[t[2]]) + arc(dist, tour[t[1] + 1], tour[t[0] + 1]) + arc(dist, tour[t[1]], k2));
+        case 1:  return delta_cost + (arc(dist, tour[t[0]], tour[t[1] + 1]) + arc(dist, tour[t[2]], tour[t[0] + 1]) + arc(dist, tour[t[1]], k2));
+        default: return delta_cost + (arc(dist, tour[t[0]], tour[t[1]]) + arc(dist, tour[t[0] + 1], tour[t[2]]) + arc(dist, tour[t[1] + 1], k2));
+    }
+}
+
+
+/// @brief first improving 2opt move that links node a to one of its candidates, inlined on one
+///        distance kernel; candidates are sorted by distance, so the scan stops as soon as the
+///        new arc is not shorter than both tour arcs of a
+DIST_INLINE cross nl_cross_scan(const TSPinst* inst, const TSPtour* tour, const unsigned int a, const arc_fun arc) {
+    const TSPdist* dist = inst->dist;
+    const double eps = COST_EPS(inst);
+    const int* cand = inst->cand + (size_t) a * inst->cand_k;
+
+    const int pred = tour_prev(tour, a), succ = tour_next(tour, a);
+    const double c_pred = arc(dist, pred, a), c_succ = arc(dist, a, succ);
+
+    for(int h = 0; h < inst->cand_k; h++) {
+        const int c = cand[h];
+        const double c_ac = arc(dist, a, c);
+        if(c_ac >= c_succ && c_ac >= c_pred) break;
+
+        if(c_ac < c_succ && c != succ) {
+            // (a,succ) (c,cn) -> (a,c) (succ,cn)
+            const int cn = tour_next(tour, c);
+            double delta_cost = (c_ac + arc(dist, succ, cn)) - (c_succ + arc(dist, c, cn));
+            if(cn != a && delta_cost < -eps) return (cross){a,c,delta_cost};
+        }
+        if(c_ac < c_pred && c != pred) {
+            // (pred,a) (cp,c) -> (a,c) (pred,cp)
+            const int cp = tour_prev(tour, c);
+            double delta_cost = (c_ac + arc(dist, pred, cp)) - (c_pred + arc(dist, cp, c));
+            if(cp != a && delta_cost < -eps) return (cross){pred,cp,delta_cost};
+        }
+    }
+    return (cross){-1,-1,EPSILON};
+}
+
+
+/// @brief bucket of the move (i,j) in a tabu_filter
+static inline unsigned int tabu_hash(const unsigned int i, const unsigned int j, const unsigned int mask) {
+    return ((i * 0x9e3779b1u) ^ (j * 0x85ebca77u)) & mask;
+}
+
+
+/// @brief check if the move that removes (x,next x) and (y,next y) is in tabu (positions of the
+///        array backend): the filter counts the moves of tabu by bucket and keeps the last one, so
+///        the list is scanned only when a bucket holds more than one move
+static inline char nl_in_tabu(const TSPtour* tour, const int x, const int y, const cross* tabu, const int tabu_size, const tabu_filter* filter) {
+    if(tabu == NULL) return 0;
+    const unsigned int i = tour->pos[x], j = tour->pos[y];
+    const unsigned int lo = (i < j) ? i : j, hi = (i < j) ? j : i;
+    const tabu_bucket* b = &filter->bucket[tabu_hash(lo, hi, filter->mask)];
+
+    if(b->count == 0) return 0;
+    if(b->count == 1) return b->i == lo && b->j == hi;
+    return is_in_tabu(lo, hi, tabu, tabu_size);
+}
+
+
+/// @brief best 2opt move that links node a to one of its candidates and is not in tabu, inlined
+///        on one distance kernel; without tabu only improving moves matter, so the scan stops as
+///        in nl_cross_scan
+DIST_INLINE cross nl_best_scan(const TSPinst* inst, const TSPtour* tour, const unsigned int a, const cross* tabu, const int tabu_size, const tabu_filter* filter, const arc_fun arc) {
+    const TSPdist* dist = inst->dist;
+    const int* cand = inst->cand + (size_t) a * inst->cand_k;
+    cross best = {-1, -1, INFINITY};
+
+    const int pred = tour_prev(tour, a), succ = tour_next(tour, a);
+    const double c_pred = arc(dist, pred, a), c_succ = arc(dist, a, succ);
+
+    for(int h = 0; h < inst->cand_k; h++) {
+        const int c = cand[h];
+        const double c_ac = arc(dist, a, c);
+        if(tabu == NULL && c_ac >= c_succ && c_ac >= c_pred) break;
+
+        if(c != succ) {
+            // (a,succ) (c,cn) -> (a,c) (succ,cn)
+            const int cn = tour_next(tour, c);
+            double delta_cost = (c_ac + arc(dist, succ, cn)) - (c_succ + arc(dist, c, cn));
+            if(cn != a && delta_cost < best.delta_cost && !nl_in_tabu(tour, a, c, tabu, tabu_size, filter))
+                best = (cross){a,c,delta_cost};
+        }
+        if(c != pred) {
+            // (pred,a) (cp,c) -> (a,c) (pred,cp)
+            const int cp = tour_prev(tour, c);
+            double delta_cost = (c_ac + arc(dist, pred, cp)) - (c_pred + arc(dist, cp, c));
+            if(cp != a && delta_cost < best.delta_cost && !nl_in_tabu(tour, pred, cp, tabu, tabu_size, filter))
+                best = (cross){pred,cp,delta_cost};
+        }
+    }
+    return best;
+}
+
+
+/// @brief improve best with a relocation of the len nodes from node s1 on next to a candidate of
+///        one of its ends s (reversed if needed), inlined on one distance kernel; candidates stop
+///        as soon as the arc (s,c) is not shorter than the gain of removing the segment
+/// @return 1 if best has been improved
+DIST_INLINE char oropt_segment(const TSPinst* inst, const TSPtour* tour, const int s1, const int len, const char first, oropt_move* best, const arc_fun arc) {
+    const TSPdist* dist = inst->dist;
+    if(len > (int) inst->nnodes - 3) return 0;
+
+    int seg[OROPT_MAX_LEN] = { s1 };
+    for(int l = 1; l < len; l++) seg[l] = tour_next(tour, seg[l-1]);
+    const int s2 = seg[len-1];
+    const int p = tour_prev(tour, s1), nx = tour_next(tour, s2);
+    const double gain = (arc(dist, p, s1) + arc(dist, s2, nx)) - arc(dist, p, nx);
+    char found = 0;
+
+    for(int side = 0; side < ((len == 1) ? 1 : 2); side++) {
+        const int s = side ? s2 : s1, o = side ? s1 : s2;
+        const int* cand = inst->cand + (size_t) s * inst->cand_k;
+
+        for(int h = 0; h < inst->cand_k; h++) {
+            const int c = cand[h];
+            const double c_sc = arc(dist, s, c);
+            if(c_sc >= gain) break;
+
+            char inside = 0;
+            for(int l = 0; l < len; l++) inside |= (seg[l] == c);
+            if(inside) continue;
+
+            // c s..o cn (u = c) or cp o..s c (u = cp); cn/cp fall in the segment only next to p/nx
+            const int cn = tour_next(tour, c), cp = tour_prev(tour, c);
+            if(cn != s1) {
+                double delta_cost = (c_sc + arc(dist, o, cn)) - arc(dist, c, cn) - gain;
+                if(delta_cost < best->delta_cost) {
+                    *best = (oropt_move) {.s = s1, .len = len, .u = c, .reversed = side, .delta_cost = delta_cost};
+                    if(first) return 1;
+                    found = 1;
+                }
+            }
+            if(cp != s2) {
+                double delta_cost = (arc(dist, cp, o) + c_sc) - arc(dist, cp, c) - gain;
+                if(delta_cost < best->delta_cost) {
+                    *best = (oropt_move) {.s = s1, .len = len, .u = cp, .reversed = !side, .delta_cost = delta_cost};
+                    if(first) return 1;
+                    found = 1;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+
+/// @brief best Or-opt move of the segments starting at nodes [from,to), inlined on one distance kernel
+DIST_INLINE oropt_move oropt_best_scan(const TSPinst* inst, const TSPtour* tour, const int from, const int to, const arc_fun arc) {
+    oropt_move best = {.s = -1, .u = -1, .delta_cost = -COST_EPS(inst)};
+
+    for(int a = from; a < to; a++)
+        for(int len = 1; len <= OROPT_MAX_LEN; len++) oropt_segment(inst, tour, a, len, 0, &best, arc);
+    return best;
+}
+
+
+/// @brief first Or-opt move of a segment starting or ending at node a, inlined on one distance kernel
+DIST_INLINE oropt_move oropt_node_scan(const TSPinst* inst, const TSPtour* tour, const unsigned int a, const arc_fun arc) {
+    oropt_move best = {.s = -1, .u = -1, .delta_cost = -COST_EPS(inst)};
+
+    int start = a;
+    for(int len = 1; len <= OROPT_MAX_LEN; len++) {
+        if(oropt_segment(inst, tour, a, len, 1, &best, arc)) break;
+        if(len == 1) continue;
+
+        start = tour_prev(tour, start);
+        if(oropt_segment(inst, tour, start, len, 1, &best, arc)) break;
+    }
+    return best;
+}
+
+
+typedef cross           (*first_cross_fun)(const TSPinst*, const int*, const int, const int);
+typedef cross           (*best_cross_fun)(const TSPinst*, const int*, const int, const int, const cross*, const int);
+typedef near_neighbor   (*nearest_fun)(const TSPinst*, const unsigned int, const char*);
+typedef double          (*kick_fun)(const TSPinst*, const int*, const int*, const int, const int);
+typedef cross           (*nl_cross_fun)(const TSPinst*, const TSPtour*, const unsigned int);
+typedef cross           (*nl_best_fun)(const TSPinst*, const TSPtour*, const unsigned int, const cross*, const int, const tabu_filter*);
+typedef oropt_move      (*oropt_best_fun)(const TSPinst*, const TSPtour*, const int, const int);
+typedef oropt_move      (*oropt_node_fun)(const TSPinst*, const TSPtour*, const unsigned int);
+
+#define KERNEL_INSTANCES(name) \
+    static cross first_cross_##name(const TSPinst* inst, const int* tour, const int from, const int to) { return first_cross_scan(inst, tour, from, to, arc_##name); } \
+    static cross best_cross_##name(const TSPinst* inst, const int* tour, const int from, const int to, const cross* tabu, const int tabu_size) { return best_cross_scan(inst, tour, from, to, tabu, tabu_size, arc_##name); } \
+    static near_neighbor nearest_##name(const TSPinst* inst, const unsigned int index, const char* res) { return nearest_scan(inst, index, res, arc_##name); } \
+    static double kick_##name(const TSPinst* inst, const int* tour, const int* t, const int k2, const int move) { return kick_scan(inst, tour, t, k2, move, arc_##name); } \
+    static cross nl_cross_##name(const TSPinst* inst, const TSPtour* tour, const unsigned int a) { return nl_cross_scan(inst, tour, a, arc_##name); } \
+    static cross nl_best_##name(const TSPinst* inst, const TSPtour* tour, const unsigned int a, const cross* tabu, const int tabu_size, const tabu_filter* filter) { return nl_best_scan(inst, tour, a, tabu, tabu_size, filter, arc_##name); } \
+    static oropt_move oropt_best_##name(const TSPinst* inst, const TSPtour* tour, const int from, const int to) { return oropt_best_scan(inst, tour, from, to, arc_##name); } \
+    static oropt_move oropt_node_##name(const TSPinst* inst, const TSPtour* tour, const unsigned int a) { return oropt_node_scan(inst, tour, a, arc_##name); }
+DIST_KERNELS(KERNEL_INSTANCES)
+
+#define FIRST_CROSS_PTR(name)   first_cross_##name,
+#define BEST_CROSS_PTR(name)    best_cross_##name,
+#define NEAREST_PTR(name)       nearest_##name,
+#define KICK_PTR(name)          kick_##name,
+#define NL_CROSS_PTR(name)      nl_cross_##name,
+#define NL_BEST_PTR(name)       nl_best_##name,
+#define OROPT_BEST_PTR(name)    oropt_best_##name,
+#define OROPT_NODE_PTR(name)    oropt_node_##name,
+static const first_cross_fun    first_cross_kernels[] = { DIST_KERNELS(FIRST_CROSS_PTR) };
+static const best_cross_fun     best_cross_kernels[] = { DIST_KERNELS(BEST_CROSS_PTR) };
+static const nearest_fun        nearest_kernels[] = { DIST_KERNELS(NEAREST_PTR) };
+static const kick_fun           kick_kernels[] = { DIST_KERNELS(KICK_PTR) };
+static const nl_cross_fun       nl_cross_kernels[] = { DIST_KERNELS(NL_CROSS_PTR) };
+static const nl_best_fun        nl_best_kernels[] = { DIST_KERNELS(NL_BEST_PTR) };
+static const oropt_best_fun     oropt_best_kernels[] = { DIST_KERNELS(OROPT_BEST_PTR) };
+static const oropt_node_fun     oropt_node_kernels[] = { DIST_KERNELS(OROPT_NODE_PTR) };
+
+#pragma endregion
+
+
+#pragma region simd_kernels
+#if DIST_X86
+
+/// @brief gather the tour in visiting order: x/y of position k (n+1 entries, the last one closes
+///        the tour) and the length of the arc (k,k+1); only planar metrics stored as double or as
+///        TSPLIB integers can be recomputed exactly from the coordinates
+/// @param inst instance of TSPinst
+/// @param tour hamiltonian circuit
+/// @param buf buffer to fill
+/// @return 1 if the instance fits the vector kernels, 0 otherwise (buf untouched)
+static char tour_buffer_new(const TSPinst* inst, const int* tour, tour_buffer* buf) {
+    const TSPdist* dist = inst->dist;
+    // pinned arcs (Karp cells) live only in the oracle: they cannot be recomputed from the coordinates
+    if(!PLANAR_METRIC(dist->metric) || dist->type == Float || dist->x == NULL || dist->pinned != NULL) return 0;
+
+    const int n = inst->nnodes;
+    const size_t bytes = ((n + 1) * sizeof(double) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    *buf = (tour_buffer) {  .x = (double*) aligned_alloc(CACHE_LINE, bytes),
+                            .y = (double*) aligned_alloc(CACHE_LINE, bytes),
+                            .edge = (double*) aligned_alloc(CACHE_LINE, bytes),
+                            .div = dist->div,
+                            .metric = dist->metric,
+                            .rounded = (dist->type == Int32) };
+
+    for(int k = 0; k < n; k++) {
+        buf->x[k] = dist->x[tour[k]];
+        buf->y[k] = dist->y[tour[k]];
+        buf->edge[k] = get_arc(inst, tour[k], tour[(k+1 == n) ? 0 : k+1]);
+    }
+    buf->x[n] = buf->x[0];
+    buf->y[n] = buf->y[0];
+    return 1;
+}
+
+
+static void tour_buffer_delete(tour_buffer* buf) {
+    free(buf->x);
+    free(buf->y);
+    free(buf->edge);
+}
+
+
+/// @brief distance between tour positions a and b, same operations (and bits) as the vector kernels
+static inline double buf_dist(const tour_buffer* buf, const int a, const int b) {
+    double dx = buf->x[b] - buf->x[a];
+    double dy = buf->y[b] - buf->y[a];
+    double raw = sqrt((dx*dx + dy*dy) / buf->div);
+    return buf->rounded ? metric_round(buf->metric, raw) : raw;
+}
+
+
+/// @brief delta cost of the 2opt move on positions (i,j), j+1 < n+1
+static inline double buf_delta(const tour_buffer* buf, const int i, const int j) {
+    return (buf_dist(buf, i, j) + buf_dist(buf, i+1, j+1)) - (buf->edge[i] + buf->edge[j]);
+}
+
+
+/// @brief 4 distances from position a to positions b..b+3 (AVX2), TSPLIB rounding by truncation
+__attribute__((target("avx2")))
+static inline __m256d buf_dist_avx2(const tour_buffer* buf, const int a, const int b) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(buf->x + b), _mm256_set1_pd(buf->x[a]));
+    __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(buf->y + b), _mm256_set1_pd(buf->y[a]));
+    __m256d raw = _mm256_sqrt_pd(_mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_set1_pd(buf->div)));
+    if(!buf->rounded) return raw;
+
+    __m256d t = (buf->metric == CEIL_2D) ? raw : _mm256_add_pd(raw, _mm256_set1_pd(0.5));
+    t = _mm256_cvtepi32_pd(_mm256_cvttpd_epi32(t));
+    if(buf->metric == EUC_2D) return t;
+    return _mm256_add_pd(t, _mm256_and_pd(_mm256_cmp_pd(t, raw, _CMP_LT_OQ), one));
+}
+
+
+/// @brief 4 deltas of the moves (i,j..j+3): stored in delta, and the mask of the ones below thr
+__attribute__((target("avx2")))
+static inline int delta_avx2(const tour_buffer* buf, const int i, const int j, const double thr, double* delta) {
+    _mm_prefetch((const char*) (buf->x + j + SIMD_PREFETCH), _MM_HINT_T0);
+    _mm_prefetch((const char*) (buf->y + j + SIMD_PREFETCH), _MM_HINT_T0);
+    _mm_prefetch((const char*) (buf->edge + j + SIMD_PREFETCH), _MM_HINT_T0);
+
+    __m256d add = _mm256_add_pd(buf_dist_avx2(buf, i, j), buf_dist_avx2(buf, i+1, j+1));
+    __m256d rem = _mm256_add_pd(_mm256_set1_pd(buf->edge[i]), _mm256_loadu_pd(buf->edge + j));
+    __m256d d = _mm256_sub_pd(add, rem);
+
+    int mask = _mm256_movemask_pd(_mm256_cmp_pd(d, _mm256_set1_pd(thr), _CMP_LT_OQ));
+    if(mask) _mm256_storeu_pd(delta, d);
+    return mask;
+}
+
+
+/// @brief 2 distances from position a to positions b,b+1 (SSE2), TSPLIB rounding by truncation
+static inline __m128d buf_dist_sse2(const tour_buffer* buf, const int a, const int b) {
+    const __m128d one = _mm_set1_pd(1.0);
+    __m128d dx = _mm_sub_pd(_mm_loadu_pd(buf->x + b), _mm_set1_pd(buf->x[a]));
+    __m128d dy = _mm_sub_pd(_mm_loadu_pd(buf->y + b), _mm_set1_pd(buf->y[a]));
+    __m128d raw = _mm_sqrt_pd(_mm_div_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_set1_pd(buf->div)));
+    if(!buf->rounded) return raw;
+
+    __m128d t = (buf->metric == CEIL_2D) ? raw : _mm_add_pd(raw, _mm_set1_pd(0.5));
+    t = _mm_cvtepi32_pd(_mm_cvttpd_epi32(t));
+    if(buf->metric == EUC_2D) return t;
+    return _mm_add_pd(t, _mm_and_pd(_mm_cmplt_pd(t, raw), one));
+}
+
+
+/// @brief 2 deltas of the moves (i,j..j+1): stored in delta, and the mask of the ones below thr
+static inline int delta_sse2(const tour_buffer* buf, const int i, const int j, const double thr, double* delta) {
+    _mm_prefetch((const char*) (buf->x + j + SIMD_PREFETCH), _MM_HINT_T0);
+    _mm_prefetch((const char*) (buf->y + j + SIMD_PREFETCH), _MM_HINT_T0);
+    _mm_prefetch((const char*) (buf->edge + j + SIMD_PREFETCH), _MM_HINT_T0);
+
+    __m128d add = _mm_add_pd(buf_dist_sse2(buf, i, j), buf_dist_sse2(buf, i+1, j+1));
+    __m128d rem = _mm_add_pd(_mm_set1_pd(buf->edge[i]), _mm_loadu_pd(buf->edge + j));
+    __m128d d = _mm_sub_pd(add, rem);
+
+    int mask = _mm_movemask_pd(_mm_cmplt_pd(d, _mm_set1_pd(thr)));
+    if(mask) _mm_storeu_pd(delta, d);
+    return mask;
+}
+
+
+typedef int (*delta_vec_fun)(const tour_buffer*, const int, const int, const double, double*);
+
+/// @brief best 2opt move with i in [from,to) not in tabu, width moves per instruction: a vector
+///        with no delta below best+eps is skipped, otherwise its lanes are replayed in order, so
+///        the move is the one of the scalar scan
+DIST_INLINE cross simd_best_scan(const tour_buffer* buf, const int n, const int from, const int to, const cross* tabu, const int tabu_size, const double eps, const int width, const delta_vec_fun vec) {
+    cross best = {-1,-1,INFINITY};
+    double delta[8];
+
+    for(int i = from; i < to; i++) {
+        const int jend = (i == 0) ? n-1 : n;
+        int j = i+2;
+
+        for(; j + width <= jend; j += width) {
+            int mask = vec(buf, i, j, best.delta_cost + eps, delta);
+            if(!mask) continue;
+
+            for(int l = __builtin_ctz(mask); l < width; l++)
+                if(delta[l] < best.delta_cost + eps && (tabu == NULL || !is_in_tabu(i, j+l, tabu, tabu_size)))
+                    best = (cross){.i=i,.j=j+l,.delta_cost=delta[l]};
+        }
+        for(; j < jend; j++) {
+            double d = buf_delta(buf, i, j);
+            if(d < best.delta_cost + eps && (tabu == NULL || !is_in_tabu(i, j, tabu, tabu_size)))
+                best = (cross){.i=i,.j=j,.delta_cost=d};
+        }
+    }
+    return best;
+}
+
+
+/// @brief first improving 2opt move with i in [from,to), width moves per instruction
+DIST_INLINE cross simd_first_scan(const tour_buffer* buf, const int n, const int from, const int to, const double eps, const int width, const delta_vec_fun vec) {
+    double delta[8];
+
+    for(int i = from; i < to; i++) {
+        const int jend = (i == 0) ? n-1 : n;
+        int j = i+2;
+
+        for(; j + width <= jend; j += width) {
+            int mask = vec(buf, i, j, -eps, delta);
+            if(mask) { int l = __builtin_ctz(mask); return (cross){i, j+l, delta[l]}; }
+        }
+        for(; j < jend; j++) {
+            double d = buf_delta(buf, i, j);
+            if(d < -eps) return (cross){i,j,d};
+        }
+    }
+    return (cross){-1,-1,EPSILON};
+}
+
+
+__attribute__((target("avx2")))
+static cross best_cross_avx2(const tour_buffer* buf, const int n, const int from, const int to, const cross* tabu, const int tabu_size, const double eps) {
+    return simd_best_scan(buf, n, from, to, tabu, tabu_size, eps, 4, delta_avx2);
+}
+
+static cross best_cross_sse2(const tour_buffer* buf, const int n, const int from, const int to, const cross* tabu, const int tabu_size, const double eps) {
+    return simd_best_scan(buf, n, from, to, tabu, tabu_size, eps, 2, delta_sse2);
+}
+
+__attribute__((target("avx2")))
+static cross first_cross_avx2(const tour_buffer* buf, const int n, const int from, const int to, const double eps) {
+    return simd_first_scan(buf, n, from, to, eps, 4, delta_avx2);
+}
+
+static cross first_cross_sse2(const tour_buffer* buf, const int n, const int from, const int to, const double eps) {
+    return simd_first_scan(buf, n, from, to, eps, 2, delta_sse2);
+}
+
+
+/// @brief true if the running cpu has AVX2
+static inline char simd_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}
+
+#endif
+#pragma endregion
+
+
+/// @brief get the nearest available neighbor form an index 
+/// @param inst instance of TSPinst
+/// @param index starting node
+/// @param res list of already viewed points
+/// @return return point and distance
+near_neighbor get_nearest_neighbor(const TSPinst* inst, const unsigned int index, const char* res) {
+    return nearest_kernels[inst->dist->kernel](inst, index, res);
+}
+
+
 /// @brief check if exists a cross between two arcs, starting from i and j
 /// @param inst instance of TSPinst 
 /// @param tour hamiltonian circuit 
@@ -114,80 +596,207 @@ inline double check_cross(const TSPinst* inst, const int* tour, const unsigned i
 }
 
 
-/// @brief provide first cross found inside tour
-/// @param inst instance of TSPinst 
-/// @param tour hamiltonian circuit
-/// @return first cross found, if exists, otherwise a cross {-1,-1, EPSILON} 
-cross find_first_cross(const TSPinst* inst, const int* tour) {
-
-    for(int i=0; i< inst->nnodes-2; i++) {
-        for(int j=i+2; j<inst->nnodes; j++) {
-            if (i==0 && j+1==inst->nnodes) continue;
-
-            double delta_cost=check_cross(inst,tour,i,j);
-            if(delta_cost < -EPSILON) return (cross){i,j,delta_cost};
-        }
+/// @brief worker: claim row blocks and write the best cross of every block in its own cache line
+/// @param userhandle pointer to mt_g2o_pars
+static void* find_best_cross_job(void* userhandle){
+    mt_g2o_pars* pars = (mt_g2o_pars*) userhandle;
+
+    unsigned int b;
+    while((b = __atomic_fetch_add(&pars->mt_next_block, 1, __ATOMIC_RELAXED)) < pars->mt_nblocks) {
+        const int from = pars->mt_block_start[b], to = pars->mt_block_start[b+1];
+
+        #if DIST_X86
+            if(pars->mt_buf != NULL) {
+                pars->mt_block_cross[b].move = simd_avx2() ? best_cross_avx2(pars->mt_buf, pars->mt_inst->nnodes, from, to, pars->mt_tabu, pars->mt_tabu_size, COST_EPS(pars->mt_inst))
+                                                           : best_cross_sse2(pars->mt_buf, pars->mt_inst->nnodes, from, to, pars->mt_tabu, pars->mt_tabu_size, COST_EPS(pars->mt_inst));
+                continue;
+            }
+        #endif
+        pars->mt_block_cross[b].move = best_cross_kernels[pars->mt_inst->dist->kernel](pars->mt_inst, pars->mt_tour, from, to, pars->mt_tabu, pars->mt_tabu_size);
     }
-    return (cross){-1,-1,EPSILON};
+    return NULL;
 }
 
 
-static void* find_best_cross_job(void* userhandle){
-    mt_g2o_pars pars = *(mt_g2o_pars*) userhandle;
-    cross my_best_cross = {-1,-1,INFINITY};
-
-    int my_id;
-    for(my_id=0;(pthread_self() != pars.mt_ctx->threads[my_id]) && my_id< pars.mt_ctx->num_threads;my_id++);
-
-    int load = pars.mt_inst->nnodes/pars.mt_ctx->num_threads;
-    int end = (my_id != pars.mt_ctx->num_threads-1) ? (my_id+1) * load: pars.mt_inst->nnodes-2;
+/// @brief worker: claim blocks of OROPT_BLOCK nodes and store the best Or-opt move of the segments starting at them
+/// @param userhandle pointer to mt_oro_pars
+static void* find_best_oropt_job(void* userhandle){
+    mt_oro_pars* pars = (mt_oro_pars*) userhandle;
+    const int n = pars->mt_inst->nnodes;
 
-    for(int i = my_id * load; i < end; i++){
-        for(int j=i+2;j<pars.mt_inst->nnodes;j++){
-            if(i==0 && j+1==pars.mt_inst->nnodes) continue;
-            
-            double delta_cost = check_cross(pars.mt_inst,pars.mt_tour,i,j);
-
-            if(delta_cost < my_best_cross.delta_cost + EPSILON && (pars.mt_tabu == NULL || !is_in_tabu(i, j, pars.mt_tabu, pars.mt_tabu_size)))
-                my_best_cross = (cross){.i=i,.j=j,.delta_cost=delta_cost};
-            
-        }
+    unsigned int b;
+    while((b = __atomic_fetch_add(&pars->mt_next_block, 1, __ATOMIC_RELAXED)) < pars->mt_nblocks) {
+        const int from = b * OROPT_BLOCK, to = (from + OROPT_BLOCK < n) ? from + OROPT_BLOCK : n;
+        pars->mt_block_move[b].move = oropt_best_kernels[pars->mt_inst->dist->kernel](pars->mt_inst, pars->mt_tour, from, to);
     }
+    return NULL;
+}
 
-    pthread_mutex_lock(&G2OPT_MTX);
-    if(my_best_cross.delta_cost < pars.mt_cross->delta_cost+EPSILON)
-        *pars.mt_cross = (cross){.i=my_best_cross.i,.j=my_best_cross.j,.delta_cost=my_best_cross.delta_cost};
-    pthread_mutex_unlock(&G2OPT_MTX);
 
-    return NULL;
+/// @brief split the rows of the (i,j) triangle in blocks of about G2OPT_AREA pairs each
+///        (row i holds n-i-2 pairs: equal rows would give the first block twice the average work)
+/// @param nnodes number of nodes
+/// @param block_start first row of every block, plus the end of the last one
+/// @return number of blocks
+static unsigned int g2opt_blocks(const unsigned int nnodes, int* block_start) {
+    const int rows = nnodes-2;
+    unsigned int nblocks = 0;
+    size_t area = 0;
+
+    block_start[0] = 0;
+    for(int i = 0; i < rows; i++) {
+        area += (i == 0) ? nnodes-3 : nnodes-i-2;
+        if(area >= G2OPT_AREA || i+1 == rows) { block_start[++nblocks] = i+1; area = 0; }
+    }
+    return nblocks;
 }
 
 
-/// @brief provide cross with max delta cost inside tour 
+/// @brief best cross not in tabu: equal-area blocks are scanned on the thread pool, then reduced
+///        without locks in block order, so the move does not depend on the number of threads
 /// @param inst instance of TSPinst
 /// @param tour hamiltonian circuit
-/// @return best cross found, if exists, otherwise a cross {-1,-1, EPSILON}
-cross find_best_cross(const TSPinst* inst, const int* tour) {
-
+/// @param tabu array of cross (NULL for none)
+/// @param tabu_size size of cross array
+/// @return best cross found, if exists, otherwise a cross {-1,-1, INFINITY}
+static cross best_cross_run(const TSPinst* inst, const int* tour, const cross* tabu, const int tabu_size) {
     cross best_cross = {-1,-1,INFINITY};
+    int rows = inst->nnodes-2;
+    if(rows <= 0) return best_cross;
 
-    mt_context* g2opt_ctx = new_mt_context((int) log2(inst->nnodes*(inst->nnodes-1)/2),!HANDLE_MTX);
-    pthread_mutex_init(&G2OPT_MTX, NULL);
+    int* block_start = (int*) malloc((rows + 1) * sizeof(int));
+    tour_buffer buf;
+    char gathered = 0;
+    #if DIST_X86
+        gathered = tour_buffer_new(inst, tour, &buf);
+    #endif
 
     mt_g2o_pars best_cross_par ={
-                            .mt_ctx = g2opt_ctx,
                             .mt_inst=inst,
                             .mt_tour=tour,
-                            .mt_cross=&best_cross,
-                            .mt_tabu=NULL,.mt_tabu_size=0};
+                            .mt_buf=gathered ? &buf : NULL,
+                            .mt_block_start=block_start,
+                            .mt_nblocks=g2opt_blocks(inst->nnodes, block_start),
+                            .mt_next_block=0,
+                            .mt_tabu=tabu,.mt_tabu_size=tabu_size};
+    best_cross_par.mt_block_cross = (cross_slot*) aligned_alloc(CACHE_LINE, best_cross_par.mt_nblocks * sizeof(cross_slot));
+
+    int tasks = (mt_pool_size() < best_cross_par.mt_nblocks) ? mt_pool_size() : best_cross_par.mt_nblocks;
+    mt_context* g2opt_ctx = new_mt_context(tasks,!HANDLE_MTX);
     run_job(g2opt_ctx,find_best_cross_job,&best_cross_par);
     delete_mt_context(g2opt_ctx,!HANDLE_MTX);
 
-    pthread_mutex_destroy(&G2OPT_MTX);
+    for(unsigned int b = 0; b < best_cross_par.mt_nblocks; b++)
+        if(best_cross_par.mt_block_cross[b].move.delta_cost < best_cross.delta_cost + COST_EPS(inst))
+            best_cross = best_cross_par.mt_block_cross[b].move;
+
+    free(best_cross_par.mt_block_cross);
+    free(block_start);
+    #if DIST_X86
+        if(gathered) tour_buffer_delete(&buf);
+    #endif
     return best_cross;
 }
 
 
+/// @brief worker: claim row blocks and write the first improving cross of every block in its own cache line
+/// @param userhandle pointer to mt_g2o_pars
+static void* find_first_cross_job(void* userhandle){
+    mt_g2o_pars* pars = (mt_g2o_pars*) userhandle;
+
+    unsigned int b;
+    while((b = __atomic_fetch_add(&pars->mt_next_block, 1, __ATOMIC_RELAXED)) < pars->mt_nblocks) {
+        const int from = pars->mt_block_start[b], to = pars->mt_block_start[b+1];
+
+        #if DIST_X86
+            if(pars->mt_buf != NULL) {
+                pars->mt_block_cross[b].move = simd_avx2() ? first_cross_avx2(pars->mt_buf, pars->mt_inst->nnodes, from, to, COST_EPS(pars->mt_inst))
+                                                           : first_cross_sse2(pars->mt_buf, pars->mt_inst->nnodes, from, to, COST_EPS(pars->mt_inst));
+                continue;
+            }
+        #endif
+        pars->mt_block_cross[b].move = first_cross_kernels[pars->mt_inst->dist->kernel](pars->mt_inst, pars->mt_tour, from, to);
+    }
+    return NULL;
+}
+
+
+/// @brief order crosses by the end of their interval [i, j+1], then by the length of the reversal
+static int cross_end_ascending(const void* elem1, const void* elem2) {
+    const cross* f = (const cross*) elem1;
+    const cross* s = (const cross*) elem2;
+    if(f->j != s->j) return (f->j > s->j) - (f->j < s->j);
+    return (f->i < s->i) - (f->i > s->i);
+}
+
+
+/// @brief speculative first improvement: the equal-area row blocks are scanned at the same time on
+///        the thread pool and each one gives its first improving cross; the crosses whose
+///        intervals [i, j+1] overlap are dropped (earliest end first), so the others touch disjoint
+///        arcs and positions and keep their delta cost once applied together
+/// @param inst instance of TSPinst
+/// @param tour hamiltonian circuit
+/// @param batch destination of the crosses (nnodes entries), sorted by position
+/// @return number of crosses in batch, 0 if the tour is 2opt optimal
+int find_first_crosses(const TSPinst* inst, const int* tour, cross* batch) {
+    int rows = inst->nnodes-2;
+    if(rows <= 0) return 0;
+
+    int* block_start = (int*) malloc((rows + 1) * sizeof(int));
+    tour_buffer buf;
+    char gathered = 0;
+    #if DIST_X86
+        gathered = tour_buffer_new(inst, tour, &buf);
+    #endif
+
+    mt_g2o_pars first_cross_par ={
+                            .mt_inst=inst,
+                            .mt_tour=tour,
+                            .mt_buf=gathered ? &buf : NULL,
+                            .mt_block_start=block_start,
+                            .mt_nblocks=g2opt_blocks(inst->nnodes, block_start),
+                            .mt_next_block=0,
+                            .mt_tabu=NULL,.mt_tabu_size=0};
+    first_cross_par.mt_block_cross = (cross_slot*) aligned_alloc(CACHE_LINE, first_cross_par.mt_nblocks * sizeof(cross_slot));
+
+    int tasks = (mt_pool_size() < first_cross_par.mt_nblocks) ? mt_pool_size() : first_cross_par.mt_nblocks;
+    mt_context* g2opt_ctx = new_mt_context(tasks,!HANDLE_MTX);
+    run_job(g2opt_ctx,find_first_cross_job,&first_cross_par);
+    delete_mt_context(g2opt_ctx,!HANDLE_MTX);
+
+    int found = 0;
+    for(unsigned int b = 0; b < first_cross_par.mt_nblocks; b++)
+        if(first_cross_par.mt_block_cross[b].move.delta_cost < -COST_EPS(inst))
+            batch[found++] = first_cross_par.mt_block_cross[b].move;
+
+    // conflict check: greedy interval scheduling keeps the most crosses with disjoint intervals
+    qsort(batch, found, sizeof(cross), cross_end_ascending);
+    int nmoves = 0;
+    unsigned int end = 0;
+    for(int k = 0; k < found; k++) {
+        if(batch[k].i < end) continue;
+        batch[nmoves++] = batch[k];
+        end = batch[k].j + 1;
+    }
+
+    free(first_cross_par.mt_block_cross);
+    free(block_start);
+    #if DIST_X86
+        if(gathered) tour_buffer_delete(&buf);
+    #endif
+    return nmoves;
+}
+
+
+/// @brief provide cross with max delta cost inside tour 
+/// @param inst instance of TSPinst
+/// @param tour hamiltonian circuit
+/// @return best cross found, if exists, otherwise a cross {-1,-1, EPSILON}
+cross find_best_cross(const TSPinst* inst, const int* tour) {
+    return best_cross_run(inst, tour, NULL, 0);
+}
+
+
 /// @brief check if a cross is in tabu
 /// @param i node i
 /// @param j node j
@@ -203,6 +812,21 @@ char is_in_tabu(int i, int j, const cross* tabu, const int tabu_size) {
 }
 
 
+/// @brief mirror the positions of the tabu moves after the rest of the tour was reversed in
+///        place of the path of a move (k -> s+1-k for the nodes, so k -> s-k for the arcs)
+/// @param tabu array of cross
+/// @param tabu_size number of moves stored
+/// @param s sum of the positions of the applied move
+/// @param n number of nodes
+void tabu_mirror(cross* tabu, const int tabu_size, const int s, const int n) {
+    for(int k = 0; k < tabu_size; k++) {
+        int i = ((s - tabu[k].i) % n + n) % n, j = ((s - tabu[k].j) % n + n) % n;
+        tabu[k].i = (i < j) ? i : j;
+        tabu[k].j = (i < j) ? j : i;
+    }
+}
+
+
 /// @brief pick best cross not in tabu
 /// @param inst instance of TSPinst
 /// @param tour Hamiltonian circuit
@@ -210,24 +834,217 @@ char is_in_tabu(int i, int j, const cross* tabu, const int tabu_size) {
 /// @param tabu_size size of cross array
 /// @return best cross not inside tabu
 cross find_best_t_cross(const TSPinst* inst, const int* tour, const cross* tabu, const int tabu_size) {
+    return best_cross_run(inst, tour, tabu, tabu_size);
+}
 
-    cross best_cross = {-1,-1,INFINITY};
 
+/// @brief first improving 2opt move with node a as an endpoint and a candidate of a as the other
+/// @param inst instance of TSPinst (with candidate lists)
+/// @param tour instance of TSPtour
+/// @param a node to examine
+/// @return cross {i,j} of nodes: (i,next i) and (j,next j) are replaced by (i,j) and (next i,next j),
+///         if exists, otherwise a cross {-1,-1, EPSILON}
+cross find_nl_cross(const TSPinst* inst, const TSPtour* tour, const unsigned int a) {
+    return nl_cross_kernels[inst->dist->kernel](inst, tour, a);
+}
 
-    mt_context* g2opt_ctx = new_mt_context((int) log2(inst->nnodes*(inst->nnodes-1)/2),!HANDLE_MTX);
-    pthread_mutex_init(&G2OPT_MTX, NULL);
 
-    mt_g2o_pars best_cross_par ={
-                            .mt_ctx = g2opt_ctx,
+/// @brief node of the smaller cached move between the leaves a and b (-1 is an empty leaf)
+static inline int cache_min(const cross_cache* cache, const int a, const int b) {
+    if(b < 0) return a;
+    if(a < 0) return b;
+    return (cache->move[b].delta_cost < cache->move[a].delta_cost) ? b : a;
+}
+
+
+/// @brief scan the candidates of node a again and fix its path to the root of the tree
+static void cache_update(cross_cache* cache, const int a, const cross* tabu, const int tabu_size) {
+    cache->move[a] = nl_best_kernels[cache->inst->dist->kernel](cache->inst, cache->tour, a, tabu, tabu_size, &cache->filter);
+    for(unsigned int p = (cache->leaves + a) >> 1; p > 0; p >>= 1)
+        cache->tree[p] = cache_min(cache, cache->tree[2*p], cache->tree[2*p+1]);
+}
+
+
+/// @brief fill the tabu filter again (the positions change with the tour): the buckets of the
+///        previous fill are emptied first, so it costs O(tabu_size)
+static void cache_tabu(cross_cache* cache, const cross* tabu, const int tabu_size) {
+    tabu_filter* filter = &cache->filter;
+    if(tabu == NULL) return;
+
+    for(int k = 0; k < filter->size; k++) filter->bucket[filter->slot[k]].count--;
+    for(int k = 0; k < tabu_size; k++) {
+        filter->slot[k] = tabu_hash(tabu[k].i, tabu[k].j, filter->mask);
+        tabu_bucket* b = &filter->bucket[filter->slot[k]];
+        *b = (tabu_bucket) { .i = tabu[k].i, .j = tabu[k].j, .count = b->count + 1 };
+    }
+    filter->size = tabu_size;
+}
+
+
+/// @brief scan every node again and rebuild the tree bottom-up
+static void cache_refresh(cross_cache* cache, const cross* tabu, const int tabu_size) {
+    const unsigned int n = cache->inst->nnodes;
+    for(unsigned int a = 0; a < n; a++)
+        cache->move[a] = nl_best_kernels[cache->inst->dist->kernel](cache->inst, cache->tour, a, tabu, tabu_size, &cache->filter);
+
+    for(unsigned int l = 0; l < cache->leaves; l++) cache->tree[cache->leaves + l] = (l < n) ? (int) l : -1;
+    for(unsigned int p = cache->leaves - 1; p > 0; p--)
+        cache->tree[p] = cache_min(cache, cache->tree[2*p], cache->tree[2*p+1]);
+    cache->dirty = 0;
+}
+
+
+/// @brief best 2opt move of every node (over its candidates) kept in a segment tree: after a
+///        move only the nodes that read one of the changed arcs are scanned again, so the best
+///        move costs O(k log n) instead of O(n²)
+/// @param inst instance of TSPinst (with candidate lists)
+/// @param tour instance of TSPtour the moves are evaluated on
+/// @param tabu array of cross (NULL if only improving moves matter)
+/// @param tabu_size size of cross array
+/// @return new instance of cross_cache, every node already scanned
+cross_cache* cross_cache_new(const TSPinst* inst, const TSPtour* tour, const cross* tabu, const int tabu_size) {
+    const unsigned int n = inst->nnodes, k = inst->cand_k;
+    cross_cache* cache = (cross_cache*) malloc(sizeof(cross_cache));
+    *cache = (cross_cache) { .inst = inst, .tour = tour, .leaves = 1 };
+    while(cache->leaves < n) cache->leaves <<= 1;
+
+    cache->move = (cross*) malloc(n * sizeof(cross));
+    cache->tree = (int*) malloc(2 * cache->leaves * sizeof(int));
+    if(tabu != NULL) {
+        // about 8 buckets per node: the tabu of the solver holds up to n/2 moves
+        unsigned int buckets = 1;
+        while(buckets < 8 * n) buckets <<= 1;
+        cache->filter = (tabu_filter) { .mask = buckets - 1,
+                                        .bucket = (tabu_bucket*) calloc(buckets, sizeof(tabu_bucket)),
+                                        .slot = (unsigned int*) malloc(n * sizeof(unsigned int)) };
+    }
+
+    // reverse candidate lists: the nodes whose scan reads the tour neighbours of a
+    cache->rcand_start = (int*) calloc(n + 1, sizeof(int));
+    cache->rcand = (int*) malloc((size_t) n * k * sizeof(int));
+    for(size_t h = 0; h < (size_t) n * k; h++) cache->rcand_start[inst->cand[h] + 1]++;
+    for(unsigned int a = 0; a < n; a++) cache->rcand_start[a+1] += cache->rcand_start[a];
+    int* fill = (int*) malloc(n * sizeof(int));
+    memcpy(fill, cache->rcand_start, n * sizeof(int));
+    for(unsigned int a = 0; a < n; a++)
+        for(unsigned int h = 0; h < k; h++) cache->rcand[fill[inst->cand[(size_t) a * k + h]]++] = a;
+    free(fill);
+
+    cache_tabu(cache, tabu, tabu_size);
+    cache_refresh(cache, tabu, tabu_size);
+    return cache;
+}
+
+
+/// @brief free a cross_cache
+/// @param cache instance of cross_cache
+void cross_cache_delete(cross_cache* cache) {
+    if(cache == NULL) return;
+    free(cache->move);
+    free(cache->tree);
+    free(cache->filter.bucket);
+    free(cache->filter.slot);
+    free(cache->rcand_start);
+    free(cache->rcand);
+    free(cache);
+}
+
+
+/// @brief the tour neighbours of some nodes changed: scan them and every node with one of them
+///        as candidate again
+/// @param cache instance of cross_cache
+/// @param ends endpoints of an applied move
+/// @param nends number of endpoints
+/// @param tabu array of cross (NULL if only improving moves matter)
+/// @param tabu_size size of cross array
+void cross_cache_touch(cross_cache* cache, const int* ends, const int nends, const cross* tabu, const int tabu_size) {
+    cache_tabu(cache, tabu, tabu_size);
+    for(int e = 0; e < nends; e++) {
+        const int a = ends[e];
+        cache_update(cache, a, tabu, tabu_size);
+        for(int r = cache->rcand_start[a]; r < cache->rcand_start[a+1]; r++)
+            cache_update(cache, cache->rcand[r], tabu, tabu_size);
+    }
+    cache->dirty = 1;
+}
+
+
+/// @brief best cached move. The nodes inside a reversed path keep a move of the old direction:
+///        the top of the tree is scanned again until its move does not change (lazy check), and
+///        before a non-improving move is returned every node is scanned once more, so no
+///        improving move is left behind
+/// @param cache instance of cross_cache
+/// @param tabu array of cross (NULL if only improving moves matter)
+/// @param tabu_size size of cross array
+/// @return cross {x,y} of nodes: (x,next x) and (y,next y) are replaced by (x,y) and (next x,next y);
+///         delta_cost is INFINITY if there is no move
+cross cross_cache_best(cross_cache* cache, const cross* tabu, const int tabu_size) {
+    cache_tabu(cache, tabu, tabu_size);
+    for(;;) {
+        const int a = cache->tree[1];
+        const cross old = cache->move[a];
+        cache_update(cache, a, tabu, tabu_size);
+
+        const cross move = cache->move[a];
+        if(move.i != old.i || move.j != old.j || move.delta_cost != old.delta_cost) continue;
+        if(move.delta_cost < -COST_EPS(cache->inst) || !cache->dirty) return move;
+        cache_refresh(cache, tabu, tabu_size);
+    }
+}
+
+
+/// @brief first improving Or-opt move that relocates a segment (up to OROPT_MAX_LEN nodes) starting
+///        or ending at node a next to a candidate of one of its ends
+/// @param inst instance of TSPinst (with candidate lists)
+/// @param tour instance of TSPtour
+/// @param a node to examine
+/// @return move found, if exists, otherwise a move with s = -1 and delta_cost = -COST_EPS
+oropt_move find_first_oropt(const TSPinst* inst, const TSPtour* tour, const unsigned int a) {
+    return oropt_node_kernels[inst->dist->kernel](inst, tour, a);
+}
+
+
+/// @brief best Or-opt move: blocks of nodes are scanned on the thread pool, then reduced in
+///        block order, so the move does not depend on the number of threads
+/// @param inst instance of TSPinst (with candidate lists)
+/// @param tour instance of TSPtour
+/// @return move found, if exists, otherwise a move with s = -1 and delta_cost = -COST_EPS
+oropt_move find_best_oropt(const TSPinst* inst, const TSPtour* tour) {
+    oropt_move best_move = {.s = -1, .u = -1, .delta_cost = -COST_EPS(inst)};
+
+    mt_oro_pars best_oropt_par ={
                             .mt_inst=inst,
                             .mt_tour=tour,
-                            .mt_cross=&best_cross,
-                            .mt_tabu=tabu,.mt_tabu_size=tabu_size};
-    run_job(g2opt_ctx,find_best_cross_job,&best_cross_par);
-    delete_mt_context(g2opt_ctx,!HANDLE_MTX);
-    
-    pthread_mutex_destroy(&G2OPT_MTX);
-    return best_cross;
+                            .mt_nblocks=(inst->nnodes + OROPT_BLOCK - 1) / OROPT_BLOCK,
+                            .mt_next_block=0};
+    best_oropt_par.mt_block_move = (oropt_slot*) aligned_alloc(CACHE_LINE, best_oropt_par.mt_nblocks * sizeof(oropt_slot));
+
+    int tasks = (mt_pool_size() < best_oropt_par.mt_nblocks) ? mt_pool_size() : best_oropt_par.mt_nblocks;
+    mt_context* oropt_ctx = new_mt_context(tasks,!HANDLE_MTX);
+    run_job(oropt_ctx,find_best_oropt_job,&best_oropt_par);
+    delete_mt_context(oropt_ctx,!HANDLE_MTX);
+
+    for(unsigned int b = 0; b < best_oropt_par.mt_nblocks; b++)
+        if(best_oropt_par.mt_block_move[b].move.delta_cost < best_move.delta_cost)
+            best_move = best_oropt_par.mt_block_move[b].move;
+
+    free(best_oropt_par.mt_block_move);
+    return best_move;
+}
+
+
+/// @brief relocate the segment of an Or-opt move between u and its successor with three flips
+///        at most: p s1..s2 nx..u v -> p u..nx s2..s1 v -> p nx..u s2..s1 v (-> p nx..u s1..s2 v)
+/// @param tour instance of TSPtour
+/// @param move Or-opt move
+void apply_oropt(TSPtour* tour, const oropt_move move) {
+    int s2 = move.s;
+    for(int l = 1; l < move.len; l++) s2 = tour_next(tour, s2);
+    const int p = tour_prev(tour, move.s), nx = tour_next(tour, s2);
+
+    tour_flip_path(tour, move.s, move.u, p);
+    tour_flip_path(tour, move.u, nx, p);
+    if(!move.reversed && move.len > 1) tour_flip_path(tour, s2, move.s, move.u);
 }
 
 
@@ -246,47 +1063,37 @@ double kick(TSPinst* inst, int* tour, const unsigned int size) {
 
 
     int k2 = (ternary[2] == size-1) ? tour[0] : tour[ternary[2] + 1];
-    double delta_cost = - ( get_arc(inst, tour[ternary[0]], tour[ternary[0] + 1]) +
-                            get_arc(inst, tour[ternary[1]], tour[ternary[1] + 1]) +
-                            get_arc(inst, tour[ternary[2]], k2));
-
-    int infuncsol[size];
-    memcpy(infuncsol, tour, size * sizeof(int));
-    switch(rand()%3)
+    int move = rand()%3;
+    double delta_cost = kick_kernels[inst->dist->kernel](inst, tour, ternary, k2, move);
+
+    // A = tour(ternary[0], ternary[1]] and B = tour(ternary[1], ternary[2]] are rearranged by path flips
+    const int x0 = tour[ternary[0]];
+    const int a1 = tour[ternary[0] + 1], a2 = tour[ternary[1]];
+    const int b1 = tour[ternary[1] + 1], b2 = tour[ternary[2]];
+    TSPtour* t = tour_new(tour, size, Array);
+    switch(move)
     {
-        case 0:
-            for(int c = 0; c < ternary[2] - ternary[1]; c++) infuncsol[ternary[0]+1+c] = tour[ternary[2] - c];
-            for(int c = 0; c < ternary[1] - ternary[0]; c++) infuncsol[ternary[0]+ ternary[2] - ternary[1]+1+c] = tour[ternary[0] + 1 + c];
-            
-            
-            delta_cost += ( get_arc(inst, tour[ternary[0]], tour[ternary[2]]) + 
-                            get_arc(inst, tour[ternary[1] + 1], tour[ternary[0] + 1]) +
-                            get_arc(inst, tour[ternary[1]], k2) );
+        case 0:     // x0 B' A k2
+            tour_flip_path(t, a1, b2, x0);
+            tour_flip_path(t, a2, a1, b1);
             break;
     
-        case 1:
-            for(int c = 0; c < ternary[2] - ternary[1]; c++) infuncsol[ternary[0] + 1 + c] = tour[ternary[1] + 1 + c];
-            for(int c = 0; c < ternary[1] - ternary[0]; c++) infuncsol[ternary[0] + ternary[2] - ternary[1] + 1 + c] = tour[ternary[0] + 1 + c];
-            
-            delta_cost += ( get_arc(inst, tour[ternary[0]], tour[ternary[1] + 1]) + 
-                            get_arc(inst, tour[ternary[2]], tour[ternary[0] + 1]) +
-                            get_arc(inst, tour[ternary[1]], k2) );
+        case 1:     // x0 B A k2
+            tour_flip_path(t, a1, b2, x0);
+            tour_flip_path(t, b2, b1, x0);
+            tour_flip_path(t, a2, a1, b2);
             break;
 
-        case 2:
-            for(int c = 0; c < ternary[1] - ternary[0]; c++) infuncsol[ternary[0] + 1 + c] = tour[ternary[1] - c];
-            for(int c = 0; c < ternary[2] - ternary[1]; c++) infuncsol[ternary[1] + 1 + c] = tour[ternary[2] - c];
-            
-            delta_cost += ( get_arc(inst, tour[ternary[0]], tour[ternary[1]]) + 
-                            get_arc(inst, tour[ternary[0] + 1], tour[ternary[2]]) +
-                            get_arc(inst, tour[ternary[1] + 1], k2) );
+        case 2:     // x0 A' B' k2
+            tour_flip_path(t, a1, a2, x0);
+            tour_flip_path(t, b1, b2, a1);
             break;
 
         default:
             print_state(Error, "Something wrong happen");
             break;
     }
-    memcpy(tour, infuncsol, size * sizeof(int));
+    tour_delete(t);
     return delta_cost;
 }
 
@@ -297,6 +1104,12 @@ double kick(TSPinst* inst, int* tour, const unsigned int size) {
 void print_sol(const TSPinst* inst,const TSPenv* env) {
     printf("\n\e[1mBest Solution Found\e[m (by \e[1m%s\e[m)\n",env->method);
 	printf("Cost: \t%10.4f\n", inst->cost);
+
+    #if VERBOSE > 1
+        printf("Tour:\t%i", instance_node_id(inst, inst->solution[0]) + 1);
+        for(int i = 1; i < inst->nnodes; i++) printf(" -> %i", instance_node_id(inst, inst->solution[i]) + 1);
+        printf("\n");
+    #endif
 }
 
 
@@ -307,14 +1120,12 @@ void print_sol(const TSPinst* inst,const TSPenv* env) {
 /// @param j node j
 /// @return pointer to dest
 char* format_arc(const TSPinst* inst,char* dest, const unsigned int i, const unsigned int j) {
-    point pi = inst->points[i];
-    point pj = inst->points[j];
-    sprintf(dest, "%10.4f,%10.4f;%10.4f,%10.4f", pi.x, pi.y, pj.x, pj.y);
+    sprintf(dest, "%10.4f,%10.4f;%10.4f,%10.4f", inst->xcoord[i], inst->ycoord[i], inst->xcoord[j], inst->ycoord[j]);
     return dest;
 }
 
 
-/// @brief Write on a file the list of arc in a particular format
+/// @brief Write on a file the list of arc in a particular format (coordinates travel with renumbered nodes)
 /// @param inst instance of TSPinst
 /// @param dest_file pointer to destination file
 void plot_log(const TSPinst* inst, FILE* dest_file) {
@@ -39,13 +39,13 @@ void print_state(int type, const char* msg, ...) {
 }
 
 
-#define INDEX(n,i,j) (i * (n - 0.5*i - 1.5) + j -1)
+#define INDEX(n,i,j) ((size_t) (i) * (2 * (size_t) (n) - (i) - 3) / 2 + (j) - 1)
 /// @brief transform 2d coordinate for a triangular matrix in 1d array
 /// @param n number of rows
 /// @param i row index
 /// @param j column index
-/// @return index where the desired value is stored into a 1d array
-inline int coords_to_index(const unsigned int n,const int i,const int j){
+/// @return index where the desired value is stored into a 1d array (64-bit: n(n-1)/2 overflows int above ~65k nodes)
+inline size_t coords_to_index(const unsigned int n,const int i,const int j){
     if (i == j) print_state(Error, "i == j");
     return i<j ? INDEX(n,i,j) : INDEX(n,j,i);
 }
@@ -93,7 +93,7 @@ void reverse(int* array, unsigned int from, unsigned int to){
 /// @return number of unque values
 int arrunique(const int* inst, const unsigned int size) {
     if(size <= 0) print_state(Error, "input not valid");
-    int elem[size];
+    int* elem = (int*) malloc(size * sizeof(int));
     elem[0] = inst[0];
     int out = 1;
     char seen = 0;
@@ -106,6 +106,7 @@ int arrunique(const int* inst, const unsigned int size) {
         if(!seen) elem[out++] = inst[i];
         seen = 0;
     }
+    free(elem);
     return out;
 }
 
@@ -196,32 +197,217 @@ void print_lifespan(const double final_time, const double init_time){
 /// @brief initialize random seed to prevent strange behaviour
 void init_random()  { for(int _=0;_<100;_++) rand();}
 
+/// @brief create a fork-join context: run_job submits num_threads tasks to the thread pool
+/// @param num_threads number of tasks (usually mt_pool_size())
+/// @param mutex 1 to init the mutex shared by the tasks
+/// @return an instance of mt_context
 mt_context* new_mt_context(int num_threads, char mutex){
     mt_context* ctx = (mt_context*) calloc(1,sizeof(mt_context));
     
     ctx->num_threads=num_threads;
-    ctx->threads = (pthread_t*) malloc(num_threads*sizeof(pthread_t));
     if(mutex) pthread_mutex_init(&ctx->mutex, NULL);
     return ctx;
 }
 
+/// @brief submit ctx->num_threads copies of a job to the thread pool and wait for all of them (fork-join)
+/// @param ctx instance of mt_context
+/// @param funct job
+/// @param args arguments shared by the tasks
 void run_job(mt_context* ctx,void* (*funct)(void*) ,void* args){
-    for(int t =0;t<ctx->num_threads;t++)
-        if(pthread_create(&ctx->threads[t],NULL,funct,args)) print_state(Error,"Bad tasks assignement!\n");
+    for(int t =0;t<ctx->num_threads;t++) mt_pool_submit(&ctx->pending, funct, args);
+    mt_pool_wait(&ctx->pending);
+}
+
+void delete_mt_context(mt_context* ctx,char mutex){
+    if(mutex) pthread_mutex_destroy(&ctx->mutex);
+    free(ctx);
+}
+
+
+/*===============================================================================*/
 
-    for(int t =0;t<ctx->num_threads;t++)
-        if(pthread_join(ctx->threads[t],NULL)) print_state(Error,"Bad tasks assignement!\n");
 
+static mt_pool* MT_POOL = NULL;
+static __thread int MT_WORKER = -1;
+
+#pragma region static_functions
+
+/// @brief push a task on the back of a queue
+static void mt_queue_push(mt_queue* q, const mt_task task) {
+    pthread_mutex_lock(&q->lock);
+    if(q->tail == q->cap) {
+        if(q->head > 0) {
+            memmove(q->tasks, q->tasks + q->head, (q->tail - q->head) * sizeof(mt_task));
+            q->tail -= q->head;
+            q->head = 0;
+        }
+        else q->tasks = (mt_task*) realloc(q->tasks, (q->cap *= 2) * sizeof(mt_task));
+    }
+    q->tasks[q->tail++] = task;
+    pthread_mutex_unlock(&q->lock);
 }
 
-void init_mt_context(mt_context* ctx,int num_threads){
-    ctx->num_threads=num_threads;
-    ctx->threads = (pthread_t*) malloc(num_threads*sizeof(pthread_t));
-    pthread_mutex_init(&ctx->mutex, NULL);
+
+/// @brief take a task from a queue: the owner pops the newest one (LIFO), thieves steal the oldest (FIFO)
+/// @param q queue
+/// @param pending group to take from (NULL for any task)
+/// @param lifo 1 for the owner of the queue, 0 for a thief
+/// @param task task taken
+/// @return 1 if a task has been taken, 0 otherwise
+static char mt_queue_take(mt_queue* q, const int* pending, const char lifo, mt_task* task) {
+    if(__atomic_load_n(&q->tail, __ATOMIC_RELAXED) == __atomic_load_n(&q->head, __ATOMIC_RELAXED)) return 0;
+
+    char found = 0;
+    pthread_mutex_lock(&q->lock);
+    for(int c = 0; c < q->tail - q->head && !found; c++) {
+        int k = lifo ? q->tail - 1 - c : q->head + c;
+        if(pending != NULL && q->tasks[k].pending != pending) continue;
+
+        *task = q->tasks[k];
+        if(k == q->head) q->head++;
+        else {
+            memmove(q->tasks + k, q->tasks + k + 1, (q->tail - k - 1) * sizeof(mt_task));
+            q->tail--;
+        }
+        found = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    if(found) __atomic_sub_fetch(&MT_POOL->queued, 1, __ATOMIC_SEQ_CST);
+    return found;
 }
 
-void delete_mt_context(mt_context* ctx,char mutex){
-    if(mutex) pthread_mutex_destroy(&ctx->mutex);
-    free(ctx->threads);
-    free(ctx);
-}
\ No newline at end of file
+
+/// @brief take a task: own queue first, then steal from the others
+/// @param pending group to take from (NULL for any task)
+static char mt_pool_take(const int* pending, mt_task* task) {
+    const int nqueues = MT_POOL->num_workers + 1;
+    const int own = (MT_WORKER >= 0) ? MT_WORKER : MT_POOL->num_workers;
+
+    if(mt_queue_take(&MT_POOL->queues[own], pending, 1, task)) return 1;
+    for(int c = 1; c < nqueues; c++)
+        if(mt_queue_take(&MT_POOL->queues[(own + c) % nqueues], pending, 0, task)) return 1;
+    return 0;
+}
+
+
+/// @brief run a task and signal its group when it is the last one
+static void mt_pool_execute(const mt_task task) {
+    task.funct(task.args);
+
+    if(__atomic_sub_fetch(task.pending, 1, __ATOMIC_SEQ_CST) == 0) {
+        pthread_mutex_lock(&MT_POOL->mutex);
+        pthread_cond_broadcast(&MT_POOL->done);
+        pthread_mutex_unlock(&MT_POOL->mutex);
+    }
+}
+
+
+/// @brief worker loop: run tasks until the pool is closed, sleep when every queue is empty
+static void* mt_pool_worker(void* userhandle) {
+    MT_WORKER = (int) (intptr_t) userhandle;
+    mt_task task;
+
+    while(1) {
+        if(mt_pool_take(NULL, &task)) { mt_pool_execute(task); continue; }
+
+        pthread_mutex_lock(&MT_POOL->mutex);
+        while(__atomic_load_n(&MT_POOL->queued, __ATOMIC_SEQ_CST) == 0 && !MT_POOL->stop) pthread_cond_wait(&MT_POOL->wake, &MT_POOL->mutex);
+        char stop = MT_POOL->stop && MT_POOL->queued == 0;
+        pthread_mutex_unlock(&MT_POOL->mutex);
+        if(stop) break;
+    }
+    return NULL;
+}
+
+#pragma endregion
+
+
+/// @brief start the persistent thread pool (the calling thread works too while it waits)
+/// @param num_threads number of threads (< 1 to use every online core)
+void mt_pool_init(int num_threads) {
+    mt_pool_close();
+    if(num_threads < 1) num_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if(num_threads < 1) num_threads = 1;
+
+    MT_POOL = (mt_pool*) calloc(1, sizeof(mt_pool));
+    MT_POOL->num_workers = num_threads - 1;
+    MT_POOL->workers = (pthread_t*) malloc(num_threads * sizeof(pthread_t));
+    MT_POOL->queues = (mt_queue*) calloc(num_threads, sizeof(mt_queue));
+    pthread_mutex_init(&MT_POOL->mutex, NULL);
+    pthread_cond_init(&MT_POOL->wake, NULL);
+    pthread_cond_init(&MT_POOL->done, NULL);
+
+    for(int q = 0; q < num_threads; q++) {
+        pthread_mutex_init(&MT_POOL->queues[q].lock, NULL);
+        MT_POOL->queues[q].cap = MT_QUEUE_SIZE;
+        MT_POOL->queues[q].tasks = (mt_task*) malloc(MT_QUEUE_SIZE * sizeof(mt_task));
+    }
+    for(int t = 0; t < MT_POOL->num_workers; t++)
+        if(pthread_create(&MT_POOL->workers[t], NULL, mt_pool_worker, (void*) (intptr_t) t)) print_state(Error,"Bad tasks assignement!\n");
+}
+
+
+/// @brief number of threads of the pool (started with every core if not yet initialized)
+int mt_pool_size() {
+    if(MT_POOL == NULL) mt_pool_init(0);
+    return MT_POOL->num_workers + 1;
+}
+
+
+/// @brief submit a task to the pool: a worker pushes on its own queue, any other thread on the shared one
+/// @param pending counter of the group (fork-join handle), incremented here
+/// @param funct job
+/// @param args arguments of the job
+void mt_pool_submit(int* pending, void* (*funct)(void*), void* args) {
+    if(MT_POOL == NULL) mt_pool_init(0);
+    __atomic_add_fetch(pending, 1, __ATOMIC_SEQ_CST);
+
+    int own = (MT_WORKER >= 0) ? MT_WORKER : MT_POOL->num_workers;
+    mt_queue_push(&MT_POOL->queues[own], (mt_task) { .funct = funct, .args = args, .pending = pending });
+
+    pthread_mutex_lock(&MT_POOL->mutex);
+    __atomic_add_fetch(&MT_POOL->queued, 1, __ATOMIC_SEQ_CST);
+    pthread_cond_signal(&MT_POOL->wake);
+    pthread_mutex_unlock(&MT_POOL->mutex);
+}
+
+
+/// @brief barrier of a group: run its queued tasks, then sleep until the running ones end
+///        (only tasks of the same group are run, so a nested wait never blocks behind a long unrelated task)
+/// @param pending counter of the group
+void mt_pool_wait(int* pending) {
+    mt_task task;
+
+    while(__atomic_load_n(pending, __ATOMIC_SEQ_CST) > 0) {
+        if(mt_pool_take(pending, &task)) { mt_pool_execute(task); continue; }
+
+        pthread_mutex_lock(&MT_POOL->mutex);
+        if(__atomic_load_n(pending, __ATOMIC_SEQ_CST) > 0) pthread_cond_wait(&MT_POOL->done, &MT_POOL->mutex);
+        pthread_mutex_unlock(&MT_POOL->mutex);
+    }
+}
+
+
+/// @brief stop the workers and free the pool
+void mt_pool_close() {
+    if(MT_POOL == NULL) return;
+
+    pthread_mutex_lock(&MT_POOL->mutex);
+    MT_POOL->stop = 1;
+    pthread_cond_broadcast(&MT_POOL->wake);
+    pthread_mutex_unlock(&MT_POOL->mutex);
+    for(int t = 0; t < MT_POOL->num_workers; t++) pthread_join(MT_POOL->workers[t], NULL);
+
+    for(int q = 0; q <= MT_POOL->num_workers; q++) {
+        pthread_mutex_destroy(&MT_POOL->queues[q].lock);
+        free(MT_POOL->queues[q].tasks);
+    }
+    pthread_mutex_destroy(&MT_POOL->mutex);
+    pthread_cond_destroy(&MT_POOL->wake);
+    pthread_cond_destroy(&MT_POOL->done);
+    free(MT_POOL->queues);
+    free(MT_POOL->workers);
+    free(MT_POOL);
+    MT_POOL = NULL;
+}